@@ -0,0 +1,70 @@
+/**
+ * @file DemoScene.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief A scene with a typical effect chain, used by the tools to replay and render recordings
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_DEMOSCENE_HPP
+#define PRGB_DEMOSCENE_HPP
+
+#include <Scene.hpp>
+#include <EffectChain.hpp>
+#include <EffectColor.hpp>
+#include <effects/EffectCurtain.hpp>
+#include <effects/EffectDots.hpp>
+#include <effects/EffectFountain.hpp>
+#include <effects/EffectGradient.hpp>
+#include <effects/EffectLoudnessLines.hpp>
+#include <effects/EffectSparkle.hpp>
+
+#include <memory>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief Background gradient, loudness lines in the lower third, sparkles, dots, a fountain and a curtain
+     */
+    class DemoScene : public Scene {
+
+        public:
+            DemoScene(LightArray* ar, TimeBase& tb, LoudnessBase& lb) 
+                : Scene(ar, tb, lb), chain(ar, lb, observe) {
+                Size size = ar->get_geometry().get_canvas_size();
+                canvas = RectArea(Point(0,0), size);
+                lines = RectArea(Point(0, 2 * size.h / 3), Size(size.w, size.h - 2 * size.h / 3));
+                center = Point(size.w / 2, size.h / 2);
+
+                effects.emplace_back(new EffectGradient(ar, canvas, center, {}, &color, 40));
+                effects.emplace_back(new EffectLoudnessLines(ar, lb, LD_Band_Bass, lines, DIR_Right, 40, &color2, &color_bg));
+                effects.emplace_back(new EffectSparkle(ar, lb, canvas, 5, &color2, {}));
+                effects.emplace_back(new EffectDots(ar, lb, observe, &color, &color2));
+                effects.emplace_back(new EffectFountain(ar, observe, 50, lb, &color2));
+                effects.emplace_back(new EffectCurtain(ar, lb, observe, canvas, &color, {}, 60, 40));
+                for (auto& e : effects) chain.add(e.get());
+
+                fx_chain = &chain;
+            }
+
+        protected:
+            EffectChain chain;
+            RectArea canvas, lines;
+            Point center;
+
+            ColorPalette palette = { RGB(255,0,0), RGB(0,255,0), RGB(0,0,255), RGB(255,255,0) };
+            EffectColorMove color = EffectColorMove(&palette, 4000, 0, CMV_Crossfade);
+            EffectColorMove color2 = EffectColorMove(&palette, 3000, 2, CMV_Softswitch);
+            EffectColorStatic color_bg = EffectColorStatic(RGB(0,0,16));
+
+            std::vector<std::unique_ptr<Effect>> effects;
+    };
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file FrameFile.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Writes rendered frames into a memory mapped file: a fixed-size header followed by raw RGB frames (3 bytes per pixel,
+ *        row by row). The frames can be viewed with any raw video tool, e.g.
+ *        ffmpeg -skip_initial_bytes 64 -f rawvideo -pixel_format rgb24 -video_size 64x64 -framerate 50 -i show.rgb show.mp4
+ *        Requires POSIX (mmap)
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_FRAMEFILE_HPP
+#define PRGB_FRAMEFILE_HPP
+
+#include <StandIns.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief Header of a frame file (64 bytes, little endian). frame_count is written when the file is closed
+     */
+    struct FrameFileHeader {
+        char magic[8] = { 'P', 'R', 'G', 'B', 'V', 'I', 'D', '1' };
+        uint32_t header_size = 64;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t bytes_per_pixel = 3;
+        uint32_t frame_ms = 0;
+        uint32_t reserved0 = 0;
+        uint64_t frame_count = 0;
+        uint8_t reserved[24] = {};
+    };
+    static_assert(sizeof(FrameFileHeader) == 64, "the header has a fixed size");
+
+    /**
+     * @brief Streams frames into a file. The file grows in chunks of frames, only the current chunk is mapped into memory.
+     *        get_frame() returns the memory of the next frame inside the mapping, so a frame is rendered directly into the file
+     *        and never copied
+     */
+    class FrameFileWriter {
+
+        public:
+            FrameFileWriter(size_t chunk_frames = 256) : chunk_frames(chunk_frames) {}
+            ~FrameFileWriter() { close(); }
+
+            /// @brief  creates the file and maps the first chunk
+            /// @return false if the file could not be created
+            bool open(const char* filename, Size size, TimeMS frame_ms) {
+                fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+                if (fd < 0) return false;
+                header.width = size.w;
+                header.height = size.h;
+                header.frame_ms = frame_ms;
+                header.frame_count = 0;
+                frame_bytes = (size_t) size.w * size.h * header.bytes_per_pixel;
+                if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) { close(); return false; }
+                return map_chunk(0);
+            }
+
+            /// @brief  memory of the frame currently being rendered
+            uint8_t* get_frame() { return frame; }
+
+            /// @brief  completes the current frame and moves to the next one
+            /// @return false if the file could not be extended
+            bool next_frame() {
+                header.frame_count++;
+                if (header.frame_count - chunk_first >= chunk_frames) return map_chunk(header.frame_count);
+                frame += frame_bytes;
+                return true;
+            }
+
+            uint64_t get_frame_count() { return header.frame_count; }
+
+            /// @brief  unmaps the file, cuts it to the completed frames and writes the frame count
+            void close() {
+                if (fd < 0) return;
+                unmap();
+                if (ftruncate(fd, sizeof(header) + header.frame_count * frame_bytes) != 0) LOG("FrameFileWriter: truncate failed");
+                if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) LOG("FrameFileWriter: header not written");
+                ::close(fd);
+                fd = -1;
+            }
+
+        protected:
+            FrameFileHeader header;
+            size_t chunk_frames;
+            size_t frame_bytes = 0;
+            int fd = -1;
+
+            uint64_t chunk_first = 0;       // first frame of the mapped chunk
+            uint8_t* map = nullptr;
+            size_t map_length = 0;
+            uint8_t* frame = nullptr;
+
+            void unmap() {
+                if (map != nullptr) munmap(map, map_length);
+                map = nullptr;
+                frame = nullptr;
+            }
+
+            /// @brief  extends the file and maps the chunk starting with frame first
+            bool map_chunk(uint64_t first) {
+                unmap();
+                size_t page = (size_t) sysconf(_SC_PAGESIZE);
+                off_t start = sizeof(header) + first * frame_bytes;
+                off_t end = start + chunk_frames * frame_bytes;
+                off_t aligned = start - (start % page);
+
+                if (ftruncate(fd, end) != 0) return false;
+                map_length = end - aligned;
+                void* m = mmap(nullptr, map_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, aligned);
+                if (m == MAP_FAILED) { map = nullptr; return false; }
+                map = (uint8_t*) m;
+                chunk_first = first;
+                frame = map + (start - aligned);
+                return true;
+            }
+    };
+
+    /**
+     * @brief A LightArray drawing into 3 byte RGB pixels of a @link FrameFileWriter @endlink. commit_buffer() completes the
+     *        frame and switches to the next frame of the file
+     */
+    class FileLightArray : public LightArray {
+
+        public:
+            FileLightArray(Size size, TimeBase& tb, FrameFileWriter& writer)
+                : LightArray(Geometry(size), tb), width(size.w), height(size.h), writer(writer) {}
+
+            virtual void set_pixel(Point pt, ColorValue color, ColorMode mode = CMODE_Set, int8_t opacity = 100) {
+                if ((pt.x < 0) || (pt.y < 0) || (pt.x >= width) || (pt.y >= height) || (writer.get_frame() == nullptr)) return;
+                uint8_t* px = writer.get_frame() + ((size_t) pt.y * width + pt.x) * 3;
+                ColorValue c = (mode == CMODE_Set) ? color : blend_pixel(RGB(px[0], px[1], px[2]), color, mode, opacity);
+                px[0] = R(c);
+                px[1] = G(c);
+                px[2] = B(c);
+            }
+
+            virtual void commit_buffer() {
+                if (!writer.next_frame()) LOG("FileLightArray: frame file could not be extended");
+            }
+
+        protected:
+            Dimension width, height;
+            FrameFileWriter& writer;
+    };
+
+}
+
+#endif
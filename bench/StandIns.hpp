@@ -0,0 +1,223 @@
+/**
+ * @file StandIns.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief In-memory implementations of the hardware abstraction (LightArray, TimeBase, LoudnessBase) to run scenes and effects 
+ *        without any hardware, e.g. for benchmarks
+ * @version 0.6
+ * @date 2024-03-12
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+
+#ifndef PRGB_STANDINS_HPP
+#define PRGB_STANDINS_HPP
+
+#include <LightArray.hpp>
+#include <LoudnessBase.hpp>
+#include <TimeBase.hpp>
+#include <SoundRecorder.hpp>
+#include <Blend.hpp>
+#include <OutputPipeline.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief A clock that only moves when told to. Frames can be rendered as fast as the CPU allows while the effects
+     *        see a steady frame rate. May be read by another thread, e.g. the sound analysis thread of the observer
+     */
+    class VirtualTimeBase : public TimeBase {
+        std::atomic<TimeMS> now;
+
+        public:
+            VirtualTimeBase(TimeMS start = 1) : now(start) {}
+            virtual TimeMS get_deltatime_ms() { return now; }
+
+            /// @brief  moves the clock forward
+            void advance(TimeMS ms) { now += ms; }
+            void set(TimeMS ms) { now = ms; }
+    };
+
+    /**
+     * @brief The frame buffer is a contiguous array of colors, row by row. commit_buffer() adds the committed frame to a checksum.
+     *        Blending uses the kernels of @link Blend.hpp @endlink, the buffer can be passed to @link Scene::set_raw_canvas() @endlink.
+     *        With more than one buffer the array is a @link FrameBufferRing @endlink for an @link OutputPipeline @endlink deeper than 1:
+     *        next_buffer() only moves the buffer that is drawn and commit_buffer() only the buffer that is committed, so the render
+     *        thread and the output thread never touch the same state
+     */
+    class MemoryLightArray : public LightArray, public RawCanvasProvider, public FrameBufferRing {
+
+        public:
+            MemoryLightArray(Size size, TimeBase& tb, size_t buffer_count = 1)
+                : LightArray(Geometry(size), tb), width(size.w), height(size.h), pixel_count((size_t) size.w * size.h),
+                  buffer_count(std::max(buffer_count, (size_t) 1)), storage(this->buffer_count * pixel_count, 0), pixels(storage.data()) {}
+
+            virtual void set_pixel(Point pt, ColorValue color, ColorMode mode = CMODE_Set, int8_t opacity = 100) {
+                if ((pt.x < 0) || (pt.y < 0) || (pt.x >= width) || (pt.y >= height)) return;
+                ColorValue& px = pixels[(size_t) pt.y * width + pt.x];
+                px = blend_pixel(px, color, mode, opacity);
+            }
+
+            /// @brief  fills or blends contiguous rows
+            virtual void fill_rect(RectArea area, ColorValue color, ColorMode mode = CMODE_Set) {
+                if ((area.origin.x < 0) || (area.origin.y < 0) || (area.origin.x + area.size.w > width) || (area.origin.y + area.size.h > height)) {
+                    LightArray::fill_rect(area, color, mode);
+                    return;
+                }
+                for (Coordinate y = area.origin.y; y < area.origin.y + area.size.h; y++) {
+                    ColorValue* row = &pixels[(size_t) y * width + area.origin.x];
+                    if (mode == CMODE_Set) std::fill_n(row, area.size.w, color); else blend_span(row, area.size.w, color, mode);
+                }
+            }
+
+            virtual void fill_all(ColorValue color) { std::fill_n(pixels, pixel_count, color); }
+
+            /// @brief  commits the buffers in the order they have been drawn, may be called by the output thread
+            virtual void commit_buffer() {
+                const ColorValue* frame = &storage[commit_index * pixel_count];
+                for (size_t i = 0; i < pixel_count; i++) checksum = checksum * 31 + frame[i];
+                commit_index = (commit_index + 1) % buffer_count;
+                commits++;
+            }
+
+            virtual RawCanvas get_raw_canvas() { return RawCanvas({ pixels, width, height, (size_t) width }); }
+
+            virtual size_t get_buffer_count() { return buffer_count; }
+
+            /// @brief  the next frame is drawn into the next buffer, called by the render thread
+            virtual void next_buffer() {
+                draw_index = (draw_index + 1) % buffer_count;
+                pixels = &storage[draw_index * pixel_count];
+            }
+
+            /// @brief  the buffer that is drawn
+            ColorValue* get_pixels() { return pixels; }
+            ColorValue get_pixel(Point pt) { return pixels[(size_t) pt.y * width + pt.x]; }
+            Dimension get_width() { return width; }
+            Dimension get_height() { return height; }
+
+            /// @brief  number of committed frames, only valid while no frame is in flight
+            uint64_t get_commit_count() { return commits; }
+
+            /// @brief  checksum of all committed frames, only valid while no frame is in flight
+            uint64_t get_checksum() { return checksum; }
+
+        protected:
+            Dimension width, height;
+            size_t pixel_count;
+            size_t buffer_count;
+            std::vector<ColorValue> storage;    // the buffers one after another
+            ColorValue* pixels;                 // the buffer that is drawn, only used by the render thread
+            size_t draw_index = 0;              // only used by the render thread
+            size_t commit_index = 0;            // only used by commit_buffer()
+            uint64_t commits = 0;
+            uint64_t checksum = 0;
+    };
+
+    /**
+     * @brief Produces reproducible "music": a beat with a kick every beat_ms, a slowly changing environment level and 6 frequency
+     *        bands that follow the kick with a little pseudo random noise. The noise only depends on the time, so the same
+     *        timestamps always produce the same values
+     */
+    class ScriptedLoudness : public LoudnessBase {
+
+        public:
+            ScriptedLoudness(TimeBase& tb, TimeMS beat_ms = 500, Loudness level = 2000) : tb(tb), beat_ms(beat_ms), level(level) {}
+
+            virtual Loudness get_loudness(LoudnessMode mode) {
+                TimeMS t = tb.get_deltatime_ms();
+                switch (mode) {
+                    case LD_environment:
+                        return level;
+                    case LD_Band_Bass:
+                        return get_freq_band(0);
+                    default:
+                        return kick(t) + noise(t, 0) % (level / 4 + 1);
+                }
+            }
+
+            virtual Loudness get_freq_band(int band) {
+                TimeMS t = tb.get_deltatime_ms();
+                Loudness k = kick(t);
+                return (Loudness) (k / (band + 1) + noise(t, band + 1) % (level / 8 + 1));
+            }
+
+            virtual bool is_silent() { return silent; }
+            virtual bool is_not_silent() { return !silent; }
+
+            void set_silent(bool silent) { this->silent = silent; }
+
+        protected:
+            TimeBase& tb;
+            TimeMS beat_ms;
+            Loudness level;
+            bool silent = false;
+
+            /// @brief  level of the kick, decays within a quarter of the beat
+            Loudness kick(TimeMS t) {
+                TimeMS pos = t % beat_ms;
+                TimeMS decay = beat_ms / 4;
+                return (pos < decay) ? (Loudness) (level * 2 * (decay - pos) / decay + level / 2) : level / 2;
+            }
+
+            /// @brief  hash of the time, the same t always returns the same value
+            static uint32_t noise(TimeMS t, uint32_t salt) {
+                uint32_t x = (uint32_t) t * 2654435761u + salt * 40503u;
+                x ^= x >> 15; x *= 2246822519u; x ^= x >> 13;
+                return x;
+            }
+    };
+
+    /**
+     * @brief Replays the timestamps of a @link SoundLog @endlink. Each call of next_frame() moves to the next recorded frame
+     */
+    class ReplayTimeBase : public TimeBase {
+
+        public:
+            ReplayTimeBase(const SoundLog& log) : log(log) {}
+
+            virtual TimeMS get_deltatime_ms() { return log.frames.empty() ? 0 : log.frames[pos].time; }
+
+            /// @brief  moves to the next frame
+            /// @return false if the end of the log has been reached
+            bool next_frame() {
+                if (pos + 1 >= log.frames.size()) return false;
+                pos++;
+                return true;
+            }
+
+            const SoundFrame& get_frame() { return log.frames[pos]; }
+            size_t get_position() { return pos; }
+
+        protected:
+            const SoundLog& log;
+            size_t pos = 0;
+    };
+
+    /**
+     * @brief Replays the loudness values of the frame the @link ReplayTimeBase @endlink is currently at
+     */
+    class ReplayLoudness : public LoudnessBase {
+
+        public:
+            ReplayLoudness(ReplayTimeBase& tb) : tb(tb) {}
+
+            virtual Loudness get_loudness(LoudnessMode mode) { return tb.get_frame().get_loudness(mode); }
+            virtual Loudness get_freq_band(int band) { return ((band >= 0) && (band < sound_frame_band_count)) ? tb.get_frame().bands[band] : 0; }
+            virtual bool is_silent() { return tb.get_frame().silent; }
+            virtual bool is_not_silent() { return tb.get_frame().not_silent; }
+
+        protected:
+            ReplayTimeBase& tb;
+    };
+
+}
+
+#endif
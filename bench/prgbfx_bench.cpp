@@ -0,0 +1,370 @@
+/**
+ * @file prgbfx_bench.cpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Renders every effect on in-memory canvases of different sizes and writes the render times and heap allocations as CSV.
+ *        Returns 1 if an effect that must not allocate memory in steady state did
+ *        Usage: prgbfx_bench [output.csv] [frames]
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <StandIns.hpp>
+
+#include <EffectChain.hpp>
+#include <EffectColor.hpp>
+#include <FrameProfiler.hpp>
+#include <SoundObserver.hpp>
+#include <effects/EffectCurtain.hpp>
+#include <effects/EffectDots.hpp>
+#include <effects/EffectFountain.hpp>
+#include <effects/EffectGradient.hpp>
+#include <effects/EffectHello.hpp>
+#include <effects/EffectLoudnessLines.hpp>
+#include <effects/EffectShapeFill.hpp>
+#include <effects/EffectSparkle.hpp>
+#include <effects/EffectSpit.hpp>
+#include <effects/EffectVUMeter.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace prgbfx;
+
+/// @brief number of heap allocations, counted by the replaced operator new
+static std::atomic<uint64_t> allocations(0);
+
+[[gnu::noinline]] void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept { free(p); }
+
+/// @brief Everything an effect needs, lives as long as one benchmark run (some effects keep references)
+struct BenchEnv {
+    VirtualTimeBase tb;
+    MemoryLightArray ar;
+    ScriptedLoudness lb;
+    SoundObserver ob;
+    RectArea canvas;
+    Point center;
+
+    ColorPalette palette = { RGB(255,0,0), RGB(0,255,0), RGB(0,0,255), RGB(255,255,0) };
+    EffectColorMove color = EffectColorMove(&palette, 2000, 0, CMV_Crossfade);
+    EffectColorMove color2 = EffectColorMove(&palette, 3000, 1, CMV_Softswitch);
+    EffectColorStatic color_bg = EffectColorStatic(RGB(0,0,16));
+
+    std::unique_ptr<Shape> shape;
+
+    BenchEnv(Size size)
+        : ar(size, tb), lb(tb), ob(lb, tb), canvas(Point(0,0), size), center(size.w / 3, size.h / 3) {}
+};
+
+/// @brief A benchmark case: creates the effect for an environment, density is the particle density of the case.
+///        allocation_free effects must not allocate memory after the warmup
+struct BenchCase {
+    std::string name;
+    std::vector<int> densities;
+    std::function<Effect*(BenchEnv& env, int density)> create;
+    bool allocation_free = false;
+};
+
+static const TimeMS frame_ms = 20;
+
+/// @brief  EffectFountain only spawns on sound peaks, so just a few of its particles are alive at a time. This one fills the array
+///         with particles of all ages in every frame, density particles are alive, to measure the integration and the plotting
+class DenseFountain : public EffectFountain {
+
+    public:
+        DenseFountain(BenchEnv& env, size_t density) : EffectFountain(&env.ar, env.ob, 100, env.lb, &env.color, density) {}
+
+        void render_effect(TimeMS time_delta) {
+            TimeMS delta = time_delta - time_start;
+            Size size = ar->get_geometry().get_canvas_size();
+            size_t n = reserve_particles(particles.get_capacity() - particles.size());
+            for (size_t i = 0; i < n; i++) {
+                TimeMS age = std::min(delta, random.below(1500));
+                spawn_particle(Point(size.w / 2, 1), (int) random.range(-size.w / 4, size.w / 4 + 1), (int) random.range(20, 60),
+                    delta - age, RGB(0,128,255));
+            }
+            EffectFountain::render_effect(time_delta);
+        }
+};
+
+/// @brief  renders warmup + frames frames and collects the render times of the effect
+/// @param allocs the number of heap allocations of the effect after the warmup
+static TimingHistogram run_effect(BenchEnv& env, Effect* e, int frames, uint64_t& allocs) {
+    TimingHistogram hist;
+    const int warmup = 100;
+
+    // like a scene with set_raw_canvas(), the particle effects blend directly into the buffer
+    RenderContext context;
+    context.canvas = env.ar.get_raw_canvas();
+    e->set_context(&context);
+
+    for (int i = 0; i < warmup + frames; i++) {
+        env.tb.advance(frame_ms);
+        TimeMS t = env.tb.get_deltatime_ms();
+        env.ar.fill_all(RGBA(0,0,0,255));
+
+        uint64_t allocs_before = allocations;
+        FrameProfiler::Clock::time_point start = FrameProfiler::Clock::now();
+        e->render_effect(t);
+        uint32_t us = FrameProfiler::elapsed_us(start);
+        if (i >= warmup) {
+            hist.add(us);
+            allocs += allocations - allocs_before;
+        }
+
+        env.ar.commit_buffer();
+        env.ob.collect_sound_data(t);
+    }
+    return hist;
+}
+
+/// @brief  measures SoundObserver::collect_sound_data on its own
+static TimingHistogram run_observer(BenchEnv& env, int frames) {
+    TimingHistogram hist;
+    for (int i = 0; i < frames; i++) {
+        env.tb.advance(frame_ms);
+        TimeMS t = env.tb.get_deltatime_ms();
+        FrameProfiler::Clock::time_point start = FrameProfiler::Clock::now();
+        env.ob.collect_sound_data(t);
+        hist.add(FrameProfiler::elapsed_us(start));
+    }
+    return hist;
+}
+
+/// @brief  measures SoundObserver::latch() and the getters while the analysis runs in its own thread, so the handover is
+///         exercised the way a scene uses it (build the bench with -fsanitize=thread to check it for data races)
+/// @param steps the number of analysis steps of the thread
+static TimingHistogram run_observer_async(BenchEnv& env, int frames, uint64_t& steps) {
+    TimingHistogram hist;
+    env.ob.start_async(5);
+    for (int i = 0; i < frames; i++) {
+        env.tb.advance(frame_ms);
+        FrameProfiler::Clock::time_point start = FrameProfiler::Clock::now();
+        env.ob.latch();
+        env.ob.get_ld_linreq_slope();
+        env.ob.get_flags();
+        env.ob.set_flag(SoundObserver::SO_Silence);     // ignored while the thread runs
+        hist.add(FrameProfiler::elapsed_us(start));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    env.ob.stop_async();
+    steps = env.ob.get_async_steps();
+    return hist;
+}
+
+/// @brief  measures the blending kernels of one instruction set: density 0 blends every row of the canvas with blend_span(),
+///         otherwise density pixels at random positions are blended with blend_pixels()
+static TimingHistogram run_kernels(BenchEnv& env, const BlendKernels& k, int density, int frames) {
+    TimingHistogram hist;
+    RawCanvas canvas = env.ar.get_raw_canvas();
+    std::vector<uint32_t> index(density);
+    std::vector<ColorValue> colors(density);
+    std::vector<int8_t> opacity(density);
+    for (int i = 0; i < density; i++) {
+        index[i] = (uint32_t) (rand() % (canvas.width * canvas.height));
+        colors[i] = RGBA(rand() % 256, rand() % 256, rand() % 256, rand() % 256);
+        opacity[i] = (int8_t) (rand() % 101);
+    }
+    for (int i = 0; i < frames; i++) {
+        FrameProfiler::Clock::time_point start = FrameProfiler::Clock::now();
+        if (density == 0) {
+            for (Coordinate y = 0; y < canvas.height; y++) k.span(canvas.row(y), canvas.width, RGB(255,128,0), CMODE_Transparent, (int8_t) (i % 101));
+        } else {
+            k.pixels(canvas.pixels, index.data(), colors.data(), opacity.data(), density, CMODE_Transparent);
+        }
+        hist.add(FrameProfiler::elapsed_us(start));
+    }
+    return hist;
+}
+
+/// @brief  compares the kernels of an instruction set with blend_pixel() over random colors in all modes, all opacities, spans of
+///         all tail lengths at all alignments and pixel lists with duplicate indices
+/// @return false if a single pixel differs
+static bool check_kernels(const BlendKernels& k) {
+    FastRandom random(1);
+    const ColorMode modes[] = { CMODE_Set, CMODE_Transparent, CMODE_Alpha };
+    const size_t buffer_size = 96;
+    ColorValue buffer[buffer_size], expected[buffer_size];
+    uint32_t index[buffer_size];
+    ColorValue colors[buffer_size];
+    int8_t opacity[buffer_size];
+
+    for (ColorMode mode : modes) {
+        for (int op = -1; op <= 101; op++) {
+            for (size_t offset = 0; offset < 8; offset++) {
+                for (size_t n = 0; n + offset <= 72; n++) {
+                    ColorValue color = random.next();
+                    for (size_t i = 0; i < buffer_size; i++) buffer[i] = expected[i] = random.next();
+                    for (size_t i = 0; i < n; i++) expected[offset + i] = blend_pixel(expected[offset + i], color, mode, (int8_t) op);
+                    k.span(buffer + offset, n, color, mode, (int8_t) op);
+                    if (!std::equal(buffer, buffer + buffer_size, expected)) {
+                        fprintf(stderr, "blend_span/%s: mode %d, opacity %d, offset %zu, length %zu differs from blend_pixel()\n", k.name, (int) mode, op, offset, n);
+                        return false;
+                    }
+                }
+            }
+        }
+
+        for (int round = 0; round < 2000; round++) {
+            // a small range of indices gives many duplicates, the whole buffer only a few
+            size_t n = random.below(buffer_size + 1);
+            uint32_t range = (round % 2) ? 8 : buffer_size;
+            for (size_t i = 0; i < buffer_size; i++) buffer[i] = expected[i] = random.next();
+            for (size_t i = 0; i < n; i++) {
+                index[i] = random.below(range);
+                colors[i] = random.next();
+                opacity[i] = (int8_t) random.range(-1, 102);
+            }
+            for (size_t i = 0; i < n; i++) expected[index[i]] = blend_pixel(expected[index[i]], colors[i], mode, opacity[i]);
+            k.pixels(buffer, index, colors, opacity, n, mode);
+            if (!std::equal(buffer, buffer + buffer_size, expected)) {
+                fprintf(stderr, "blend_pixels/%s: mode %d, %zu pixels in a range of %u differ from blend_pixel()\n", k.name, (int) mode, n, range);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// @brief  renders a particle effect with a budget of its own and a smaller scene budget (see @link ParticleBudget @endlink)
+/// @return false if the effect had more live particles than the budgets allow, or did not both spawn and drop particles
+template <typename E>
+static bool check_budget(const char* name, BenchEnv& env, E& e, size_t budget, int frames) {
+    ParticleBudget scene_budget(budget / 2);
+    RenderContext context;
+    context.particles = &scene_budget;
+    e.set_context(&context);
+    e.set_particle_budget(budget);
+
+    size_t max_live = 0;
+    for (int i = 0; i < frames; i++) {
+        env.tb.advance(frame_ms);
+        TimeMS t = env.tb.get_deltatime_ms();
+        scene_budget.reset();
+        e.render_effect(t);
+        env.ob.collect_sound_data(t);
+        max_live = std::max(max_live, e.get_particle_count());
+    }
+    const ParticleStats& stats = e.get_particle_stats();
+    if ((max_live <= budget / 2) && (stats.spawned > 0) && (stats.dropped > 0)) return true;
+    fprintf(stderr, "%s: budget %zu not applied: max live %zu, spawned %llu, dropped %llu\n", name, budget / 2, max_live,
+        (unsigned long long) stats.spawned, (unsigned long long) stats.dropped);
+    return false;
+}
+
+static void write_row(FILE* out, const std::string& name, Size size, int density, int frames, const TimingHistogram& h, uint64_t allocs = 0) {
+    fprintf(out, "%s,%d,%d,%d,%d,%u,%u,%u,%u,%.2f\n", name.c_str(), size.w, size.h, density, frames,
+        h.get_avg(), h.get_p50(), h.get_p99(), h.get_max(), (double) allocs / frames);
+    fflush(out);
+}
+
+int main(int argc, char** argv) {
+    FILE* out = (argc > 1) ? fopen(argv[1], "w") : stdout;
+    if (out == nullptr) { perror(argv[1]); return 1; }
+    int frames = (argc > 2) ? atoi(argv[2]) : 500;
+
+    std::vector<Size> sizes = { Size(16,16), Size(64,64), Size(128,128) };
+
+    std::vector<BenchCase> cases = {
+        { "EffectHello", { 0 }, [](BenchEnv& env, int) -> Effect* { return new EffectHello(&env.ar); } },
+        { "EffectGradient", { 0 }, [](BenchEnv& env, int) -> Effect* {
+            return new EffectGradient(&env.ar, env.canvas, env.center, {}, &env.color); } },
+        { "EffectLoudnessLines", { 0 }, [](BenchEnv& env, int) -> Effect* {
+            return new EffectLoudnessLines(&env.ar, env.lb, LD_Band_Bass, env.canvas, DIR_Right, 30, &env.color, &env.color_bg); } },
+        { "EffectShapeFill", { 0 }, [](BenchEnv& env, int) -> Effect* {
+            env.shape = std::make_unique<Rect>(&env.ar, RectInit({ .box = env.canvas, .posmods = {}, .color = &env.color }));
+            return new EffectShapeFill(&env.ar, *env.shape); } },
+        { "EffectVUMeter", { 0 }, [](BenchEnv& env, int) -> Effect* {
+            return new EffectVUMeter(&env.ar, env.lb, env.canvas, &env.color); } },
+        { "EffectSparkle", { 1, 10, 100, 3000 }, [](BenchEnv& env, int density) -> Effect* {
+            return new EffectSparkle(&env.ar, env.lb, env.canvas, density, &env.color, {}, 20, 180, 65536); }, true },
+        { "EffectFountain", { 1, 10 }, [](BenchEnv& env, int density) -> Effect* {
+            return new EffectFountain(&env.ar, env.ob, 100 / density, env.lb, &env.color); }, true },
+        { "EffectFountain (dense)", { 1000, 4000 }, [](BenchEnv& env, int density) -> Effect* {
+            return new DenseFountain(env, density); }, true },
+        { "EffectDots", { 1 }, [](BenchEnv& env, int) -> Effect* {
+            return new EffectDots(&env.ar, env.lb, env.ob, &env.color, &env.color2); }, true },
+        { "EffectCurtain", { 1, 10 }, [](BenchEnv& env, int density) -> Effect* {
+            return new EffectCurtain(&env.ar, env.lb, env.ob, env.canvas, &env.color, {}, 100 / density, 20); }, true },
+        { "EffectSpit", { 0 }, [](BenchEnv& env, int) -> Effect* {
+            return new EffectSpit(&env.ar, env.lb, env.ob, env.canvas, &env.color); } },
+    };
+
+    fprintf(out, "name,width,height,density,frames,avg_us,p50_us,p99_us,max_us,allocs_per_frame\n");
+    int result = 0;
+
+    // all kernels have to give exactly the results of blend_pixel()
+    for (BlendISA isa : { BLEND_Scalar, BLEND_SSE2, BLEND_AVX2 }) {
+        const BlendKernels* k = get_blend_kernels(isa);
+        if ((k != nullptr) && !check_kernels(*k)) result = 1;
+    }
+
+    for (auto& size : sizes) {
+        for (auto& c : cases) {
+            for (int density : c.densities) {
+                BenchEnv env(size);
+                std::unique_ptr<Effect> e(c.create(env, density));
+                e->seed_random(1);
+                uint64_t allocs = 0;
+                write_row(out, c.name, size, density, frames, run_effect(env, e.get(), frames, allocs), allocs);
+                if (c.allocation_free && (allocs > 0)) {
+                    fprintf(stderr, "%s (%dx%d, density %d): %llu allocations in steady state\n", c.name.c_str(), size.w, size.h, density, (unsigned long long) allocs);
+                    result = 1;
+                }
+            }
+        }
+        BenchEnv env(size);
+        write_row(out, "SoundObserver::collect_sound_data", size, 0, frames, run_observer(env, frames));
+        uint64_t steps = 0;
+        write_row(out, "SoundObserver::latch (async)", size, 0, frames, run_observer_async(env, frames, steps));
+        if (steps == 0) {
+            fprintf(stderr, "SoundObserver (%dx%d): the analysis thread did not run\n", size.w, size.h);
+            result = 1;
+        }
+
+        for (BlendISA isa : { BLEND_Scalar, BLEND_SSE2, BLEND_AVX2 }) {
+            const BlendKernels* k = get_blend_kernels(isa);
+            if (k == nullptr) continue;
+            srand(1);
+            write_row(out, std::string("blend_span/") + k->name, size, 0, frames, run_kernels(env, *k, 0, frames));
+            write_row(out, std::string("blend_pixels/") + k->name, size, size.w * size.h / 4, frames, run_kernels(env, *k, size.w * size.h / 4, frames));
+        }
+    }
+
+    // the budgets apply to every particle effect
+    {
+        BenchEnv env(Size(64,64));
+        EffectFountain fountain(&env.ar, env.ob, 10, env.lb, &env.color);
+        if (!check_budget("EffectFountain", env, fountain, 2, 2000)) result = 1;
+    }
+    {
+        BenchEnv env(Size(64,64));
+        EffectCurtain curtain(&env.ar, env.lb, env.ob, env.canvas, &env.color, {}, 10, 20);
+        if (!check_budget("EffectCurtain", env, curtain, 20, 500)) result = 1;
+    }
+    {
+        BenchEnv env(Size(64,64));
+        EffectDots dots(&env.ar, env.lb, env.ob, &env.color, &env.color2);
+        if (!check_budget("EffectDots", env, dots, 2, 2000)) result = 1;
+    }
+
+    if (out != stdout) fclose(out);
+    return result;
+}
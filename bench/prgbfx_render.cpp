@@ -0,0 +1,75 @@
+/**
+ * @file prgbfx_render.cpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Renders a scene offline, much faster than real time, into a frame file (see @link FrameFileWriter @endlink)
+ *        Usage: prgbfx_render <output> <seconds> [width height] [sound log]
+ *        Without a sound log scripted sound input is used
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <StandIns.hpp>
+#include <FrameFile.hpp>
+#include <DemoScene.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+using namespace prgbfx;
+
+static const TimeMS frame_ms = 20;
+
+/// @brief  renders frames of the demo scene into the writer, next() moves the clock and returns false after the last frame
+template <typename F>
+static uint64_t render(FrameFileWriter& writer, Size size, TimeBase& tb, LoudnessBase& lb, uint32_t seed, F next) {
+    FileLightArray ar(size, tb, writer);
+    DemoScene scene(&ar, tb, lb);
+    scene.seed_effects(seed);
+    do {
+        scene.runScene();
+    } while (next());
+    return scene.get_frame_count();
+}
+
+int main(int argc, char** argv) {
+    int seconds = (argc >= 3) ? atoi(argv[2]) : 0;
+    Size size = (argc >= 5) ? Size(atoi(argv[3]), atoi(argv[4])) : Size(64,64);
+    if ((seconds <= 0) || (size.w <= 0) || (size.h <= 0)) {
+        fprintf(stderr, "usage: %s <output> <seconds> [width height] [sound log]\n"
+                        "       seconds, width and height have to be greater than 0\n", argv[0]);
+        return 2;
+    }
+
+    FrameFileWriter writer;
+    if (!writer.open(argv[1], size, frame_ms)) { perror(argv[1]); return 1; }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t frames;
+
+    if (argc >= 6) {
+        // replay a recording, the timestamps of the log are used
+        std::ifstream in(argv[5], std::ios::binary);
+        SoundLog log;
+        if (!in || !log.read(in) || log.frames.empty()) { fprintf(stderr, "%s: not a sound log\n", argv[5]); return 1; }
+        ReplayTimeBase tb(log);
+        ReplayLoudness lb(tb);
+        TimeMS end = log.frames[0].time + seconds * 1000;
+        frames = render(writer, size, tb, lb, log.seed, [&tb, end]() { return tb.next_frame() && (tb.get_deltatime_ms() < end); });
+    } else {
+        // virtual clock stepping at the frame interval
+        VirtualTimeBase tb;
+        ScriptedLoudness lb(tb);
+        uint64_t count = seconds * 1000 / frame_ms;
+        frames = render(writer, size, tb, lb, 1, [&tb, &count]() { tb.advance(frame_ms); return --count > 0; });
+    }
+
+    writer.close();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu frames (%dx%d) in %.2f s, %.0f fps\n", (unsigned long long) frames, size.w, size.h, secs, frames / secs);
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file prgbfx_replay.cpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Records scripted sound input into a sound log or replays a sound log through a scene as fast as possible
+ *        Usage: prgbfx_replay record <log> <seconds> [seed]
+ *               prgbfx_replay replay <log> [width height]
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <StandIns.hpp>
+#include <DemoScene.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace prgbfx;
+
+static const TimeMS frame_ms = 20;
+
+/// @brief  runs the demo scene with scripted sound and records the sound input
+static int record(const char* file, int seconds, uint32_t seed) {
+    std::ofstream out(file, std::ios::binary);
+    if (!out) { perror(file); return 1; }
+
+    VirtualTimeBase tb;
+    ScriptedLoudness lb(tb);
+    MemoryLightArray ar(Size(64,64), tb);
+    SoundRecorder recorder(lb, tb);
+    recorder.begin(out, seed);
+
+    DemoScene scene(&ar, tb, lb);
+    scene.seed_effects(seed);
+    scene.set_raw_canvas(&ar);
+    scene.set_sound_recorder(&recorder);
+    // the replay creates the scene at the time of the first frame, so the first frame is rendered before the clock moves
+    for (int i = 0; i < seconds * 1000 / (int) frame_ms; i++) {
+        scene.runScene();
+        tb.advance(frame_ms);
+    }
+    recorder.end();
+    // a replay at the same canvas size must produce the checksum of the recording
+    printf("frames %llu recorded, checksum %016llx\n", (unsigned long long) recorder.get_frame_count(), (unsigned long long) ar.get_checksum());
+    return 0;
+}
+
+/// @brief  replays a log through the demo scene and prints the profile
+/// @param threads render threads (see Scene::set_render_threads()), the checksum has to be the same for any number
+/// @param depth frames in flight of the output pipeline (see Scene::set_pipeline_depth()), 0 commits in runScene(). The array gets
+///        a buffer per frame in flight, the checksum has to be the same for any depth
+static int replay(const char* file, Size size, unsigned threads, unsigned depth) {
+    std::ifstream in(file, std::ios::binary);
+    SoundLog log;
+    if (!in || !log.read(in) || log.frames.empty()) { fprintf(stderr, "%s: not a sound log\n", file); return 1; }
+
+    ReplayTimeBase tb(log);
+    ReplayLoudness lb(tb);
+    MemoryLightArray ar(size, tb, depth);
+
+    DemoScene scene(&ar, tb, lb);
+    scene.seed_effects(log.seed);
+    scene.set_raw_canvas(&ar);
+    scene.set_render_threads(threads);
+    scene.set_pipeline_depth(depth, &ar);
+    scene.set_profiling(true);
+
+    auto start = std::chrono::steady_clock::now();
+    do {
+        scene.runScene();
+    } while (tb.next_frame());
+    size_t in_flight = scene.get_output_pipeline() ? scene.get_output_pipeline()->get_depth() : 0;
+    scene.set_pipeline_depth(0); // commits the frames in flight
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t checksum = ar.get_checksum();
+
+    FrameProfiler& prof = scene.get_profiler();
+    printf("frames %llu, %.1f fps, checksum %016llx, blend kernels %s, frames in flight %zu\n", (unsigned long long) scene.get_frame_count(),
+        scene.get_frame_count() / secs, (unsigned long long) checksum, get_best_blend_kernels().name, in_flight);
+    printf("part,p50_us,p99_us,max_us\n");
+    printf("frame,%u,%u,%u\n", prof.frame.get_p50(), prof.frame.get_p99(), prof.frame.get_max());
+    printf("sound,%u,%u,%u\n", prof.sound.get_p50(), prof.sound.get_p99(), prof.sound.get_max());
+    for (size_t i = 0; i < prof.get_effect_count(); i++) {
+        const FrameProfiler::EffectTiming& t = prof.get_effect(i);
+        printf("%s,%u,%u,%u\n", prof.get_label(i).c_str(), t.render.get_p50(), t.render.get_p99(), t.render.get_max());
+    }
+    const FrameProfiler::EffectTiming& other = prof.get_other();
+    if (other.render.get_count() > 0) printf("%s,%u,%u,%u\n", other.name, other.render.get_p50(), other.render.get_p99(), other.render.get_max());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if ((argc >= 4) && (strcmp(argv[1], "record") == 0)) {
+        return record(argv[2], atoi(argv[3]), (argc > 4) ? (uint32_t) strtoul(argv[4], nullptr, 0) : 1);
+    }
+    if ((argc >= 3) && (strcmp(argv[1], "replay") == 0)) {
+        Size size = (argc >= 5) ? Size(atoi(argv[3]), atoi(argv[4])) : Size(64,64);
+        return replay(argv[2], size, (argc >= 6) ? (unsigned) atoi(argv[5]) : 1, (argc >= 7) ? (unsigned) atoi(argv[6]) : 0);
+    }
+    fprintf(stderr, "usage: %s record <log> <seconds> [seed]\n       %s replay <log> [width height [threads [depth]]]\n", argv[0], argv[0]);
+    return 2;
+}
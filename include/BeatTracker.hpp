@@ -0,0 +1,216 @@
+/**
+ * @file BeatTracker.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Detects onsets in the frequency bands and follows the tempo and the phase of the beat, in fixed memory and constant time per step
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_BEATTRACKER_HPP
+#define PRGB_BEATTRACKER_HPP
+
+#include <LoudnessBase.hpp>
+#include <TimeBase.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief An onset is a sudden rise of the loudness in the frequency bands: the rises of all bands since the last step are summed
+     *        up (spectral flux) and compared with the average flux of the last second. The intervals between an onset and the
+     *        previous onsets vote for a tempo (folded into one octave, so double or half
+     *        intervals vote for the same tempo) in a histogram which slowly forgets older votes. The strongest tempo predicts the next
+     *        beat, onsets close to a predicted beat pull the prediction towards them
+     */
+    class BeatTracker {
+
+        public:
+            static const uint8_t max_bands = 8;
+            static const uint16_t bpm_min = 80;             // one octave, so every interval votes for exactly one tempo
+            static const uint16_t bpm_max = 2 * bpm_min;
+            static const uint8_t onset_history = 16;        // onsets used for the tempo votes
+
+            static const TimeMS min_onset_gap = 100;        // onsets closer to the last one are ignored
+            static const TimeMS max_vote_interval = 2000;   // longer intervals do not vote
+            static const TimeMS beat_timeout = 4000;        // no beats are predicted after this time without onsets
+            static const TimeMS flux_time = 1000;           // time constant of the average flux
+
+            BeatTracker() { reset(); }
+
+            /// @brief  forgets the tempo, the phase and all onsets
+            void reset() {
+                std::fill_n(previous, max_bands, 0.0);
+                std::fill_n(histogram, bpm_max - bpm_min + 1, 0.0f);
+                has_previous = false;
+                flux = flux_mean = flux_dev = 0;
+                onset_head = onset_filled = 0;
+                last_time = last_onset = 0;
+                onset = beat = false;
+                period = 0;
+                next_beat = 0;
+                on_beat = off_beat = 0;
+                onsets = beats = 0;
+            }
+
+            /**
+             * @brief One analysis step, may be called at any rate
+             *
+             * @param time time stamp of the step
+             * @param bands_db loudness of the frequency bands in dB
+             * @param band_count number of bands, at most max_bands are used
+             * @param silent no onsets are detected in silence
+             */
+            void update(TimeMS time, const LoudnessDB* bands_db, uint8_t band_count, bool silent = false) {
+                band_count = std::min(band_count, max_bands);
+                onset = beat = false;
+
+                flux = 0;
+                if (has_previous) {
+                    for (uint8_t b = 0; b < band_count; b++) flux += std::max(0.0, bands_db[b] - previous[b]);
+                }
+                std::copy_n(bands_db, band_count, previous);
+
+                if (has_previous && !silent) {
+                    double threshold = flux_mean + 1.5 * flux_dev + 1.0;
+                    if ((flux > threshold) && ((onsets == 0) || (time - last_onset >= min_onset_gap))) add_onset(time);
+
+                    // the average follows the flux with the same time constant at any rate
+                    double dt = (double) (time - last_time);
+                    double alpha = dt / (flux_time + dt);
+                    flux_mean += alpha * (flux - flux_mean);
+                    flux_dev += alpha * (std::abs(flux - flux_mean) - flux_dev);
+                }
+                has_previous = true;
+                last_time = time;
+
+                // beats stop if the music does
+                if ((next_beat > 0) && (time - last_onset > beat_timeout)) next_beat = 0;
+
+                if ((next_beat > 0) && (time >= next_beat)) {
+                    beat = true;
+                    beats++;
+                    // skip the beats missed since the last step
+                    next_beat += period * (1 + (int64_t) ((time - next_beat) / period));
+                }
+            }
+
+            /// @brief  true if the last step detected an onset
+            inline bool is_onset() const { return onset; }
+
+            /// @brief  true if a predicted beat has been reached in the last step
+            inline bool is_beat() const { return beat; }
+
+            /// @brief  the spectral flux of the last step in dB
+            inline double get_flux() const { return flux; }
+
+            /// @brief  true if a tempo has been found and the beats are followed
+            inline bool has_tempo() const { return next_beat > 0; }
+
+            /// @brief  the tempo in beats per minute, 0 without a tempo
+            inline double get_bpm() const { return has_tempo() ? 60000.0 / period : 0.0; }
+
+            /// @brief  the time between two beats in ms, 0 without a tempo
+            inline double get_beat_period() const { return has_tempo() ? period : 0.0; }
+
+            /// @brief  the time stamp of the next predicted beat, 0 without a tempo
+            inline TimeMS get_next_beat() const { return (TimeMS) next_beat; }
+
+            inline uint32_t get_onset_count() const { return onsets; }
+            inline uint32_t get_beat_count() const { return beats; }
+
+        protected:
+            static constexpr float vote_decay = 0.9f;   // weight of the older votes at each onset
+            static constexpr float min_votes = 2.0f;    // weight a tempo needs to be followed
+
+            LoudnessDB previous[max_bands];
+            bool has_previous;
+            double flux, flux_mean, flux_dev;
+            TimeMS last_time, last_onset;
+            bool onset, beat;
+
+            TimeMS onset_times[onset_history];           // ring buffer of the last onsets
+            uint8_t onset_head, onset_filled;
+            float histogram[bpm_max - bpm_min + 1];     // votes for each tempo in bpm
+
+            double period;                              // ms per beat
+            double next_beat;                           // time stamp of the next beat, 0 without a tempo
+            double on_beat, off_beat;                   // flux of the recent onsets close to / between the predicted beats
+            uint32_t onsets, beats;
+
+            void add_onset(TimeMS time) {
+                onset = true;
+                onsets++;
+                last_onset = time;
+
+                vote(time);
+                onset_times[onset_head] = time;
+                onset_head = (onset_head + 1) % onset_history;
+                if (onset_filled < onset_history) onset_filled++;
+
+                // the strongest tempo including its neighbours, the intervals are only as exact as the time between two steps
+                int bins = bpm_max - bpm_min + 1;
+                int best = 0;
+                double best_votes = 0, best_sum = 0;
+                for (int i = 0; i < bins; i++) {
+                    double votes = 0, sum = 0;
+                    for (int j = std::max(0, i - 2); j <= std::min(bins - 1, i + 2); j++) {
+                        votes += histogram[j];
+                        sum += histogram[j] * j;
+                    }
+                    if (votes > best_votes) { best = i; best_votes = votes; best_sum = sum; }
+                }
+                if (histogram[best] < min_votes) return;
+                period = 60000.0 / (bpm_min + best_sum / best_votes);
+
+                if (next_beat == 0) {
+                    next_beat = time + period;
+                    return;
+                }
+
+                // distance to the nearest predicted beat, an onset close to it moves the prediction halfway
+                double error = time - (next_beat - period);
+                if (error > period / 2) error -= period;
+                on_beat *= vote_decay;
+                off_beat *= vote_decay;
+                if (std::abs(error) < period / 4) {
+                    next_beat += error / 2;
+                    on_beat += flux;
+                } else {
+                    off_beat += flux;
+                }
+
+                // the stronger onsets are on the beat: if those between the beats are stronger, the prediction is half a beat off
+                if (off_beat > 1.5 * on_beat) {
+                    next_beat += (next_beat - period / 2 > time) ? -period / 2 : period / 2;
+                    std::swap(on_beat, off_beat);
+                }
+            }
+
+            /// @brief  each interval to a previous onset votes for the tempo it fits into the range of the histogram
+            void vote(TimeMS time) {
+                for (auto& h : histogram) h *= vote_decay;
+                for (uint8_t i = 0; i < onset_filled; i++) {
+                    TimeMS interval = time - onset_times[i];
+                    if ((interval == 0) || (interval > max_vote_interval)) continue;
+                    double bpm = 60000.0 / interval;
+                    while (bpm < bpm_min - 0.5) bpm *= 2;
+                    while (bpm > bpm_max + 0.5) bpm /= 2;
+                    int bin = std::clamp((int) (bpm + 0.5) - (int) bpm_min, 0, bpm_max - bpm_min);
+                    histogram[bin] += 1.0f;
+                    if (bin > 0) histogram[bin - 1] += 0.5f;
+                    if (bin < bpm_max - bpm_min) histogram[bin + 1] += 0.5f;
+                }
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file Blend.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Blending kernels for CMODE_Transparent and CMODE_Alpha working on a raw frame buffer of ColorValues. A span of
+ *        pixels is blended with one color, a gathered set of pixels with individual colors. The kernels exist as scalar code and,
+ *        on x86, as SSE2 and AVX2 code. The best kernels supported by the CPU are selected at runtime, all of them produce
+ *        exactly the same result as @link blend_pixel() @endlink
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_BLEND_HPP
+#define PRGB_BLEND_HPP
+
+#include <LightArray.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(PRGBFX_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PRGBFX_BLEND_X86 1
+#include <immintrin.h>
+#endif
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief The frame buffer of a LightArray which stores one ColorValue per pixel (alpha in the top byte), row by row.
+     *        Effects blend into it directly instead of calling set_pixel() for every pixel
+     */
+    struct RawCanvas {
+        ColorValue* pixels = nullptr;
+        Dimension width = 0;
+        Dimension height = 0;
+        size_t stride = 0;          /// distance between two rows in pixels
+
+        inline bool is_valid() const { return pixels != nullptr; }
+        inline ColorValue* row(Coordinate y) const { return pixels + (size_t) y * stride; }
+    };
+
+    /**
+     * @brief Implemented by LightArrays which can provide their frame buffer as @link RawCanvas @endlink,
+     *        see @link Scene::set_raw_canvas() @endlink
+     */
+    class RawCanvasProvider {
+        public:
+            virtual ~RawCanvasProvider() {}
+
+            /// @brief  the buffer the current frame is drawn into. Is called once per frame before the effects are rendered
+            virtual RawCanvas get_raw_canvas() = 0;
+    };
+
+    /// @brief  the weight of the new color and the maximum weight of a mode
+    inline void blend_weight(ColorMode mode, ColorValue color, int8_t opacity, int32_t& weight, int32_t& max) {
+        if (mode == CMODE_Alpha) {
+            weight = A(color);
+            max = 255;
+        } else {
+            weight = (opacity < 0) ? 0 : (opacity > 100) ? 100 : opacity;
+            max = 100;
+        }
+    }
+
+    /// @brief  combines the color of a pixel with a new color, this is the reference for all kernels.
+    ///         Each channel is dst+(color-dst)*weight/max, rounded towards zero like @link prgb::gradient() @endlink, the alpha of dst is kept
+    /// @param dst current color of the pixel
+    /// @param color new color
+    /// @param mode CMODE_Set replaces, CMODE_Transparent uses opacity, CMODE_Alpha uses the alpha channel of color
+    /// @param opacity 0-100
+    /// @return the resulting color
+    inline ColorValue blend_pixel(ColorValue dst, ColorValue color, ColorMode mode, int8_t opacity) {
+        if (mode == CMODE_Set) return color;
+        int32_t w, max;
+        blend_weight(mode, color, opacity, w, max);
+        auto channel = [w, max](int32_t d, int32_t s) { return (uint8_t) (d + (s - d) * w / max); };
+        return RGBA(channel(R(dst), R(color)), channel(G(dst), G(color)), channel(B(dst), B(color)), A(dst));
+    }
+
+    /// @brief blends n contiguous pixels with one color
+    typedef void (*BlendSpanKernel)(ColorValue* dst, size_t n, ColorValue color, ColorMode mode, int8_t opacity);
+
+    /// @brief blends buffer[index[i]] with colors[i] for i < n in this order. opacity is only used for CMODE_Transparent
+    typedef void (*BlendPixelsKernel)(ColorValue* buffer, const uint32_t* index, const ColorValue* colors, const int8_t* opacity, size_t n, ColorMode mode);
+
+    enum BlendISA { BLEND_Scalar, BLEND_SSE2, BLEND_AVX2 };
+
+    /// @brief A set of blending kernels for one instruction set
+    struct BlendKernels {
+        BlendISA isa;
+        const char* name;
+        BlendSpanKernel span;
+        BlendPixelsKernel pixels;
+    };
+
+    namespace blend {
+
+        inline void span_scalar(ColorValue* dst, size_t n, ColorValue color, ColorMode mode, int8_t opacity) {
+            for (size_t i = 0; i < n; i++) dst[i] = blend_pixel(dst[i], color, mode, opacity);
+        }
+
+        inline void pixels_scalar(ColorValue* buffer, const uint32_t* index, const ColorValue* colors, const int8_t* opacity, size_t n, ColorMode mode) {
+            for (size_t i = 0; i < n; i++) {
+                ColorValue& px = buffer[index[i]];
+                px = blend_pixel(px, colors[i], mode, opacity ? opacity[i] : 100);
+            }
+        }
+
+#ifdef PRGBFX_BLEND_X86
+
+        // The channels are processed as 16 bit lanes: |color-dst|*weight is at most 255*255, the division by 100 or 255 is a
+        // multiplication with the high 16 bits of the product plus a shift, which is exact for all values in this range.
+        // The sign is applied afterwards, so the result is rounded towards zero like the scalar code
+        inline void blend_magic(ColorMode mode, uint16_t& magic, int& shift) {
+            if (mode == CMODE_Alpha) { magic = 32897; shift = 7; } else { magic = 5243; shift = 3; }
+        }
+
+        /// @brief  weights of two pixels as 16 bit lanes (the alpha lanes are 0, so the alpha of dst is kept)
+        __attribute__((target("sse2"))) inline __m128i weights_sse2(int32_t w0, int32_t w1) {
+            return _mm_set_epi16(0, (short) w1, (short) w1, (short) w1, 0, (short) w0, (short) w0, (short) w0);
+        }
+
+        /// @brief  blends 8 lanes (two pixels) of dst with src
+        __attribute__((target("sse2"))) inline __m128i mix_sse2(__m128i dst, __m128i src, __m128i w, __m128i magic, __m128i shift) {
+            __m128i diff = _mm_sub_epi16(src, dst);
+            __m128i sign = _mm_srai_epi16(diff, 15);
+            __m128i prod = _mm_mullo_epi16(_mm_sub_epi16(_mm_xor_si128(diff, sign), sign), w);
+            __m128i q = _mm_srl_epi16(_mm_mulhi_epu16(prod, magic), shift);
+            return _mm_add_epi16(dst, _mm_sub_epi16(_mm_xor_si128(q, sign), sign));
+        }
+
+        /// @brief  blends 4 pixels with 4 colors, w_lo/w_hi are the weights of pixels 0,1 and 2,3
+        __attribute__((target("sse2"))) inline __m128i blend4_sse2(__m128i px, __m128i src, __m128i w_lo, __m128i w_hi, __m128i magic, __m128i shift) {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i lo = mix_sse2(_mm_unpacklo_epi8(px, zero), _mm_unpacklo_epi8(src, zero), w_lo, magic, shift);
+            __m128i hi = mix_sse2(_mm_unpackhi_epi8(px, zero), _mm_unpackhi_epi8(src, zero), w_hi, magic, shift);
+            return _mm_packus_epi16(lo, hi);
+        }
+
+        /// @brief  the alpha weights of 4 colors, the alpha channel of each pixel is copied into its color lanes
+        __attribute__((target("sse2"))) inline void alpha_weights_sse2(__m128i src, __m128i& w_lo, __m128i& w_hi) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+            __m128i lo = _mm_unpacklo_epi8(src, zero);
+            __m128i hi = _mm_unpackhi_epi8(src, zero);
+            w_lo = _mm_and_si128(_mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xff), 0xff), mask);
+            w_hi = _mm_and_si128(_mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xff), 0xff), mask);
+        }
+
+        __attribute__((target("sse2"))) inline void span_sse2(ColorValue* dst, size_t n, ColorValue color, ColorMode mode, int8_t opacity) {
+            if (mode == CMODE_Set) { span_scalar(dst, n, color, mode, opacity); return; }
+            int32_t w, max;
+            blend_weight(mode, color, opacity, w, max);
+            if (w == 0) return;
+            uint16_t m; int s;
+            blend_magic(mode, m, s);
+            const __m128i magic = _mm_set1_epi16((short) m), shift = _mm_cvtsi32_si128(s);
+            const __m128i src = _mm_set1_epi32((int) color), weights = weights_sse2(w, w);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128i px = _mm_loadu_si128((const __m128i*) (dst + i));
+                _mm_storeu_si128((__m128i*) (dst + i), blend4_sse2(px, src, weights, weights, magic, shift));
+            }
+            span_scalar(dst + i, n - i, color, mode, opacity);
+        }
+
+        /// @brief  true if two of the 4 indices are equal, those pixels have to be blended one after another
+        __attribute__((target("sse2"))) inline bool has_duplicates_sse2(__m128i idx) {
+            __m128i eq = _mm_or_si128(_mm_cmpeq_epi32(idx, _mm_shuffle_epi32(idx, 0x39)), _mm_cmpeq_epi32(idx, _mm_shuffle_epi32(idx, 0x4e)));
+            return _mm_movemask_epi8(eq) != 0;
+        }
+
+        __attribute__((target("sse2"))) inline void pixels_sse2(ColorValue* buffer, const uint32_t* index, const ColorValue* colors, const int8_t* opacity, size_t n, ColorMode mode) {
+            if (mode == CMODE_Set) { pixels_scalar(buffer, index, colors, opacity, n, mode); return; }
+            uint16_t m; int s;
+            blend_magic(mode, m, s);
+            const __m128i magic = _mm_set1_epi16((short) m), shift = _mm_cvtsi32_si128(s);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const uint32_t* ix = index + i;
+                __m128i idx = _mm_loadu_si128((const __m128i*) ix);
+                if (has_duplicates_sse2(idx)) { pixels_scalar(buffer, ix, colors + i, opacity ? opacity + i : nullptr, 4, mode); continue; }
+
+                __m128i src = _mm_loadu_si128((const __m128i*) (colors + i));
+                __m128i w_lo, w_hi;
+                if (mode == CMODE_Alpha) {
+                    alpha_weights_sse2(src, w_lo, w_hi);
+                } else {
+                    int32_t w[4], max;
+                    for (int k = 0; k < 4; k++) blend_weight(mode, 0, opacity ? opacity[i + k] : 100, w[k], max);
+                    w_lo = weights_sse2(w[0], w[1]);
+                    w_hi = weights_sse2(w[2], w[3]);
+                }
+                __m128i px = _mm_set_epi32((int) buffer[ix[3]], (int) buffer[ix[2]], (int) buffer[ix[1]], (int) buffer[ix[0]]);
+                alignas(16) ColorValue out[4];
+                _mm_store_si128((__m128i*) out, blend4_sse2(px, src, w_lo, w_hi, magic, shift));
+                for (int k = 0; k < 4; k++) buffer[ix[k]] = out[k];
+            }
+            pixels_scalar(buffer, index + i, colors + i, opacity ? opacity + i : nullptr, n - i, mode);
+        }
+
+        __attribute__((target("avx2"))) inline __m256i mix_avx2(__m256i dst, __m256i src, __m256i w, __m256i magic, __m128i shift) {
+            __m256i diff = _mm256_sub_epi16(src, dst);
+            __m256i sign = _mm256_srai_epi16(diff, 15);
+            __m256i prod = _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_xor_si256(diff, sign), sign), w);
+            __m256i q = _mm256_srl_epi16(_mm256_mulhi_epu16(prod, magic), shift);
+            return _mm256_add_epi16(dst, _mm256_sub_epi16(_mm256_xor_si256(q, sign), sign));
+        }
+
+        /// @brief  blends 8 pixels, w_lo holds the weights of pixels 0,1,4,5 and w_hi of 2,3,6,7 (the unpack instructions work per 128 bit lane)
+        __attribute__((target("avx2"))) inline __m256i blend8_avx2(__m256i px, __m256i src, __m256i w_lo, __m256i w_hi, __m256i magic, __m128i shift) {
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i lo = mix_avx2(_mm256_unpacklo_epi8(px, zero), _mm256_unpacklo_epi8(src, zero), w_lo, magic, shift);
+            __m256i hi = mix_avx2(_mm256_unpackhi_epi8(px, zero), _mm256_unpackhi_epi8(src, zero), w_hi, magic, shift);
+            return _mm256_packus_epi16(lo, hi);
+        }
+
+        __attribute__((target("avx2"))) inline void span_avx2(ColorValue* dst, size_t n, ColorValue color, ColorMode mode, int8_t opacity) {
+            if (mode == CMODE_Set) { span_scalar(dst, n, color, mode, opacity); return; }
+            int32_t w, max;
+            blend_weight(mode, color, opacity, w, max);
+            if (w == 0) return;
+            uint16_t m; int s;
+            blend_magic(mode, m, s);
+            const __m256i magic = _mm256_set1_epi16((short) m);
+            const __m128i shift = _mm_cvtsi32_si128(s);
+            const __m256i src = _mm256_set1_epi32((int) color);
+            const __m256i weights = _mm256_set_epi16(0, (short) w, (short) w, (short) w, 0, (short) w, (short) w, (short) w,
+                                                     0, (short) w, (short) w, (short) w, 0, (short) w, (short) w, (short) w);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256i px = _mm256_loadu_si256((const __m256i*) (dst + i));
+                _mm256_storeu_si256((__m256i*) (dst + i), blend8_avx2(px, src, weights, weights, magic, shift));
+            }
+            span_sse2(dst + i, n - i, color, mode, opacity);
+        }
+
+        /// @brief  true if two of the 8 indices are equal. Rotating by 1 to 4 lanes compares every pair
+        __attribute__((target("avx2"))) inline bool has_duplicates_avx2(__m256i idx) {
+            __m256i eq = _mm256_setzero_si256();
+            for (int r = 1; r <= 4; r++) {
+                __m256i rot = _mm256_permutevar8x32_epi32(idx, _mm256_add_epi32(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_epi32(r)));
+                eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(idx, rot)); // permutevar only uses the lowest 3 bits of the lane index
+            }
+            return _mm256_movemask_epi8(eq) != 0;
+        }
+
+        __attribute__((target("avx2"))) inline void pixels_avx2(ColorValue* buffer, const uint32_t* index, const ColorValue* colors, const int8_t* opacity, size_t n, ColorMode mode) {
+            if (mode == CMODE_Set) { pixels_scalar(buffer, index, colors, opacity, n, mode); return; }
+            uint16_t m; int s;
+            blend_magic(mode, m, s);
+            const __m256i magic = _mm256_set1_epi16((short) m);
+            const __m128i shift = _mm_cvtsi32_si128(s);
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i mask = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const uint32_t* ix = index + i;
+                __m256i idx = _mm256_loadu_si256((const __m256i*) ix);
+                if (has_duplicates_avx2(idx)) { pixels_scalar(buffer, ix, colors + i, opacity ? opacity + i : nullptr, 8, mode); continue; }
+
+                __m256i src = _mm256_loadu_si256((const __m256i*) (colors + i));
+                __m256i w_lo, w_hi;
+                if (mode == CMODE_Alpha) {
+                    __m256i lo = _mm256_unpacklo_epi8(src, zero), hi = _mm256_unpackhi_epi8(src, zero);
+                    w_lo = _mm256_and_si256(_mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xff), 0xff), mask);
+                    w_hi = _mm256_and_si256(_mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xff), 0xff), mask);
+                } else {
+                    int32_t w[8], max;
+                    for (int k = 0; k < 8; k++) blend_weight(mode, 0, opacity ? opacity[i + k] : 100, w[k], max);
+                    w_lo = _mm256_set_m128i(weights_sse2(w[4], w[5]), weights_sse2(w[0], w[1]));
+                    w_hi = _mm256_set_m128i(weights_sse2(w[6], w[7]), weights_sse2(w[2], w[3]));
+                }
+                __m256i px = _mm256_i32gather_epi32((const int*) buffer, idx, 4);
+                alignas(32) ColorValue out[8];
+                _mm256_store_si256((__m256i*) out, blend8_avx2(px, src, w_lo, w_hi, magic, shift));
+                for (int k = 0; k < 8; k++) buffer[ix[k]] = out[k];
+            }
+            pixels_sse2(buffer, index + i, colors + i, opacity ? opacity + i : nullptr, n - i, mode);
+        }
+
+#endif
+
+    }
+
+    /// @brief  the kernels for an instruction set
+    /// @return nullptr if the instruction set is not supported by the compiler or the CPU
+    inline const BlendKernels* get_blend_kernels(BlendISA isa) {
+        static const BlendKernels scalar = { BLEND_Scalar, "scalar", blend::span_scalar, blend::pixels_scalar };
+#ifdef PRGBFX_BLEND_X86
+        static const BlendKernels sse2 = { BLEND_SSE2, "sse2", blend::span_sse2, blend::pixels_sse2 };
+        static const BlendKernels avx2 = { BLEND_AVX2, "avx2", blend::span_avx2, blend::pixels_avx2 };
+        __builtin_cpu_init();
+        switch (isa) {
+            case BLEND_AVX2: return __builtin_cpu_supports("avx2") ? &avx2 : nullptr;
+            case BLEND_SSE2: return __builtin_cpu_supports("sse2") ? &sse2 : nullptr;
+            default: return &scalar;
+        }
+#else
+        return (isa == BLEND_Scalar) ? &scalar : nullptr;
+#endif
+    }
+
+    /// @brief  the fastest kernels supported by the CPU, selected once
+    inline const BlendKernels& get_best_blend_kernels() {
+        static const BlendKernels* best = []() {
+            for (BlendISA isa : { BLEND_AVX2, BLEND_SSE2 }) {
+                const BlendKernels* k = get_blend_kernels(isa);
+                if (k) return k;
+            }
+            return get_blend_kernels(BLEND_Scalar);
+        }();
+        return *best;
+    }
+
+    /// @brief  blends n contiguous pixels with one color, same result as calling @link blend_pixel() @endlink for each of them
+    inline void blend_span(ColorValue* dst, size_t n, ColorValue color, ColorMode mode, int8_t opacity = 100) {
+        get_best_blend_kernels().span(dst, n, color, mode, opacity);
+    }
+
+    /// @brief  blends buffer[index[i]] with colors[i], same result as calling @link blend_pixel() @endlink for each of them in
+    ///         order, so an index may appear more than once
+    /// @param opacity one opacity per pixel for CMODE_Transparent, nullptr means 100
+    inline void blend_pixels(ColorValue* buffer, const uint32_t* index, const ColorValue* colors, const int8_t* opacity, size_t n, ColorMode mode) {
+        get_best_blend_kernels().pixels(buffer, index, colors, opacity, n, mode);
+    }
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file Clip.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Helper functions to clip rectangular areas against each other
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_CLIP_HPP
+#define PRGB_CLIP_HPP
+
+#include <Coordinates.hpp>
+#include <algorithm>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /// @brief  true if the area does not contain a single pixel
+    inline bool is_empty(const RectArea& a) { return (a.size.w <= 0) || (a.size.h <= 0); }
+
+    /// @brief  calculates the overlapping part of two areas
+    /// @return the intersection, an empty area (size 0,0) if they do not overlap
+    inline RectArea intersect(const RectArea& a, const RectArea& b) {
+        int x1 = std::max<int>(a.origin.x, b.origin.x);
+        int y1 = std::max<int>(a.origin.y, b.origin.y);
+        int x2 = std::min<int>(a.origin.x + a.size.w, b.origin.x + b.size.w);
+        int y2 = std::min<int>(a.origin.y + a.size.h, b.origin.y + b.size.h);
+        if ((x2 <= x1) || (y2 <= y1)) return RectArea(Point(x1, y1), Size(0, 0));
+        return RectArea(Point(x1, y1), Size(x2 - x1, y2 - y1));
+    }
+
+    /// @brief  calculates the smallest area containing both areas. Empty areas are ignored
+    /// @return the bounding box
+    inline RectArea unite(const RectArea& a, const RectArea& b) {
+        if (is_empty(a)) return b;
+        if (is_empty(b)) return a;
+        int x1 = std::min<int>(a.origin.x, b.origin.x);
+        int y1 = std::min<int>(a.origin.y, b.origin.y);
+        int x2 = std::max<int>(a.origin.x + a.size.w, b.origin.x + b.size.w);
+        int y2 = std::max<int>(a.origin.y + a.size.h, b.origin.y + b.size.h);
+        return RectArea(Point(x1, y1), Size(x2 - x1, y2 - y1));
+    }
+
+    /// @brief  number of pixels in the area
+    inline int32_t get_area(const RectArea& a) { return is_empty(a) ? 0 : (int32_t) a.size.w * a.size.h; }
+
+    /// @brief  true if the areas overlap or touch each other
+    inline bool is_adjacent(const RectArea& a, const RectArea& b) {
+        return (a.origin.x <= b.origin.x + b.size.w) && (b.origin.x <= a.origin.x + a.size.w) &&
+               (a.origin.y <= b.origin.y + b.size.h) && (b.origin.y <= a.origin.y + a.size.h);
+    }
+
+}
+
+#endif
@@ -19,6 +19,8 @@ namespace prgbfx {
     
     using namespace prgb;
 
+    struct SoundSnapshot;
+
     /// @brief Abstract base class. Effects can make use of this class to apply modifications to the color / brightness, the @link modify() @endlink 
     class ColorModifier {
 
@@ -29,11 +31,29 @@ namespace prgbfx {
             /// @return the modified color
             virtual ColorValue modify(ColorValue color, TimeMS time_delta) = 0;
 
+            /// @brief  describes the modification at a point in time as prgb::dim() by a percentage, so a @link ColorPipeline @endlink
+            ///         can evaluate the modifier once per frame instead of calling modify() for each color
+            /// @param time_delta
+            /// @param percent the factor for prgb::dim()
+            /// @param off set to true if the color is switched off (replaced by 0)
+            /// @return false if the modification can't be described this way, modify() is called for each color then
+            virtual bool get_linear(TimeMS time_delta, uint16_t& percent, bool& off) { return false; }
+
+            /// @brief  modifiers depending on the sound read the sound input of the frame from this snapshot. The effect owning
+            ///         the modifier passes the snapshot of its @link RenderContext @endlink, see @link set_sound_snapshots() @endlink
+            /// @param snapshot nullptr to read the sound directly
+            virtual void set_sound_snapshot(const SoundSnapshot* snapshot) {}
+
     };
 
     /// @brief A vector of ColorModifiers (for each effect, multiple Color Modifiers can be applied)
     typedef std::vector<ColorModifier *> ColorModifiers;
 
+    /// @brief  passes the sound snapshot of the frame to all modifiers
+    inline void set_sound_snapshots(const ColorModifiers& colmods, const SoundSnapshot* snapshot) {
+        for (auto cmod : colmods) cmod->set_sound_snapshot(snapshot);
+    }
+
     /// @brief Strobo effect, requires on/off times which can not be shorter than one frame (so no real Strobo effect)
     class ColorModifierStrobo : public ColorModifier {
         uint16_t on_ms, off_ms;
@@ -44,15 +64,26 @@ namespace prgbfx {
             virtual ~ColorModifierStrobo() { LOG(" ColorModifierStrobo: Destruct");}
 
             virtual ColorValue modify(ColorValue color, TimeMS time_delta) {
-                TimeMS interval = on_ms + off_ms;
-                TimeMS pos = time_delta % interval;
-                return (pos >= on_ms) ? 0 : color;
+                return is_off(time_delta) ? 0 : color;
             }                
 
+            virtual bool get_linear(TimeMS time_delta, uint16_t& percent, bool& off) {
+                percent = 100;
+                off = is_off(time_delta);
+                return true;
+            }
+
             void set_delay(TimeMS on_ms, TimeMS off_ms) {
                 this->on_ms = on_ms;
                 this->off_ms = off_ms;
             };
+
+        protected:
+            inline bool is_off(TimeMS time_delta) {
+                TimeMS interval = on_ms + off_ms;
+                TimeMS pos = time_delta % interval;
+                return (pos >= on_ms);
+            }
     };
 
     /// @brief Attenuates (< 100) or brightens (> 100) the color
@@ -63,6 +94,12 @@ namespace prgbfx {
             ColorModifierStatic(uint16_t fade) : ColorModifier() { LOG(" ColorModifierStatic: Create"); this->fade = fade; }
             virtual ~ColorModifierStatic() {LOG(" ColorModifierStatic: Destruct"); }
             virtual ColorValue modify(ColorValue color, TimeMS time_delta) { return prgb::dim(color, fade); }
+
+            virtual bool get_linear(TimeMS time_delta, uint16_t& percent, bool& off) {
+                percent = fade;
+                off = false;
+                return true;
+            }
     
     };
 
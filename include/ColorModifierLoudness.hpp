@@ -15,6 +15,7 @@
 #include <ColorModifier.hpp>
 #include <Color.hpp>
 #include <LoudnessBase.hpp>
+#include <SoundSnapshot.hpp>
 #include <TimeBase.hpp>
 
 namespace prgbfx {
@@ -35,19 +36,31 @@ namespace prgbfx {
                 };
 
             virtual ~ColorModifierLoudness() { LOG(" ColorModifierLoudness: Destruct"); }
+
+            /// @brief  reads the sound input of the frame from a snapshot, see @link Scene::get_sound_snapshot() @endlink
+            virtual void set_sound_snapshot(const SoundSnapshot* snapshot) { sound.set_snapshot(snapshot); }
             
             virtual ColorValue modify(ColorValue color, TimeMS time_delta) {
+                return prgb::dim(color,get_level(time_delta));
+            }
 
-                Loudness loud = lb.get_loudness(ld_mode);
-                Loudness ref = sft_reference.value(time_delta,loud);
-
-                loud = sft_level.normalized(time_delta,loud,ref,100);
-                
-                return prgb::dim(color,loud);
+            virtual bool get_linear(TimeMS time_delta, uint16_t& percent, bool& off) {
+                percent = get_level(time_delta);
+                off = false;
+                return true;
             }
         
         protected:
+            /// @brief  the brightness in percent, updates the softeners
+            Loudness get_level(TimeMS time_delta) {
+                Loudness loud = sound.get_loudness(ld_mode);
+                Loudness ref = sft_reference.value(time_delta,loud);
+
+                return sft_level.normalized(time_delta,loud,ref,100);
+            }
+
             LoudnessBase& lb;
+            SoundSource sound = SoundSource(lb);
             LoudnessMode ld_mode;
             uint16_t sensitivity;
             TimeMS fade_ms;
@@ -0,0 +1,89 @@
+/**
+ * @file ColorPipeline.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Applies a list of @link ColorModifier @endlink to many colors, the modifiers are evaluated once per frame
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_COLORPIPELINE_HPP
+#define PRGB_COLORPIPELINE_HPP
+
+#include <ColorModifier.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief prepare() asks each modifier for its modification at the time of the frame (see @link ColorModifier::get_linear() @endlink).
+     *        apply() then needs no virtual calls: a gate (a strobe that is off) replaces the color by 0, the factors are applied
+     *        with prgb::dim() in the order of the modifiers. Modifiers that can't be described by a factor are still called
+     *        for each color at their position in the list
+     */
+    class ColorPipeline {
+
+        public:
+            ColorPipeline() { steps.reserve(4); }
+
+            /// @brief  evaluates the modifiers, called once per frame before apply()
+            /// @param colmods
+            /// @param time_delta the time stamp of the frame, passed to the modifiers that are called for each color
+            void prepare(const ColorModifiers& colmods, TimeMS time_delta) {
+                this->time_delta = time_delta;
+                steps.clear();
+                off = false;
+                for (auto cmod : colmods) {
+                    uint16_t percent = 100;
+                    bool gate_off = false;
+                    if (!cmod->get_linear(time_delta, percent, gate_off)) {
+                        steps.push_back(Step({ cmod, 100 }));
+                    } else if (gate_off) {
+                        // everything before is replaced by 0, dim() keeps 0 until a modifier is called
+                        off = true;
+                        steps.clear();
+                    } else if ((percent != 100) && !(off && steps.empty())) {
+                        steps.push_back(Step({ nullptr, percent }));
+                    }
+                }
+            }
+
+            /// @brief  true if apply() returns the colors unchanged
+            inline bool is_identity() const { return !off && steps.empty(); }
+
+            /// @brief  the modified color
+            inline ColorValue apply(ColorValue color) const {
+                if (off) color = 0;
+                for (const Step& s : steps) {
+                    color = (s.modifier == nullptr) ? prgb::dim(color, s.percent) : s.modifier->modify(color, time_delta);
+                }
+                return color;
+            }
+
+            /// @brief  modifies n colors in place
+            void apply(ColorValue* colors, size_t n) const {
+                if (is_identity()) return;
+                for (size_t i = 0; i < n; i++) colors[i] = apply(colors[i]);
+            }
+
+        protected:
+            /// @brief  one modification, a modifier that is called for each color or a factor for prgb::dim()
+            struct Step {
+                ColorModifier* modifier;
+                uint16_t percent;
+            };
+
+            std::vector<Step> steps;
+            bool off = false;
+            TimeMS time_delta = 0;
+    };
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ * @file DirtyRegion.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Collects the rectangular areas which have been drawn during a frame
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_DIRTYREGION_HPP
+#define PRGB_DIRTYREGION_HPP
+
+#include <Coordinates.hpp>
+#include <Clip.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief A DirtyRegion is a list of non-overlapping rectangles. Areas that overlap or touch an existing rectangle are merged into it.
+     *        The number of rectangles is limited, when the list is full the new area is merged with the rectangle that grows least
+     *        by doing so. All areas are clipped to the bounds (usually the canvas). No memory is allocated.
+     */
+    class DirtyRegion {
+
+        public:
+            static const size_t max_rects = 32;
+
+            DirtyRegion() {}
+            DirtyRegion(RectArea bounds) : bounds(bounds) {}
+
+            void set_bounds(RectArea bounds) { this->bounds = bounds; clear(); }
+
+            void clear() { count = 0; }
+
+            /// @brief  marks an area as changed
+            /// @param area
+            void add(RectArea area) {
+                area = intersect(area, bounds);
+                if (is_empty(area)) return;
+
+                // swallow all rectangles touching the new area, the result might touch others
+                for (size_t i = 0; i < count; ) {
+                    if (is_adjacent(rects[i], area)) {
+                        area = unite(area, rects[i]);
+                        rects[i] = rects[--count];
+                        i = 0;
+                    } else {
+                        i++;
+                    }
+                }
+
+                while (count == max_rects) {
+                    // no room left: merge with the rectangle which grows least
+                    size_t best = 0;
+                    int32_t best_growth = INT32_MAX;
+                    for (size_t i = 0; i < count; i++) {
+                        int32_t growth = get_area(unite(rects[i], area)) - get_area(rects[i]);
+                        if (growth < best_growth) { best = i; best_growth = growth; }
+                    }
+                    area = unite(area, rects[best]);
+                    rects[best] = rects[--count];
+
+                    // the bigger area might overlap others now
+                    for (size_t i = 0; i < count; ) {
+                        if (is_adjacent(rects[i], area)) {
+                            area = unite(area, rects[i]);
+                            rects[i] = rects[--count];
+                            i = 0;
+                        } else {
+                            i++;
+                        }
+                    }
+                }
+
+                rects[count++] = area;
+            }
+
+            /// @brief  adds all rectangles of another region
+            void add(const DirtyRegion& other) {
+                for (size_t i = 0; i < other.count; i++) add(other.rects[i]);
+            }
+
+            /// @brief  marks the entire bounds as changed
+            void add_all() { clear(); add(bounds); }
+
+            size_t size() const { return count; }
+            bool empty() const { return count == 0; }
+            const RectArea& operator[](size_t i) const { return rects[i]; }
+
+            /// @brief  number of pixels inside the region
+            int32_t get_pixel_count() const {
+                int32_t sum = 0;
+                for (size_t i = 0; i < count; i++) sum += get_area(rects[i]);
+                return sum;
+            }
+
+            /// @brief  calls func(x, y, length) for each row of each rectangle
+            template <typename F> void for_each_span(F&& func) const {
+                for (size_t i = 0; i < count; i++) {
+                    const RectArea& r = rects[i];
+                    for (Coordinate y = r.origin.y; y < r.origin.y + r.size.h; y++) func(r.origin.x, y, r.size.w);
+                }
+            }
+
+        protected:
+            RectArea bounds;
+            std::array<RectArea, max_rects> rects;
+            size_t count = 0;
+    };
+
+    /**
+     * @brief The bounding box of many small areas, e.g. of all particles of an effect in a frame. Adding an area only costs a few
+     *        comparisons, the box is added to the DirtyRegion once instead of merging every area into it
+     */
+    class DirtyBounds {
+
+        public:
+            /// @brief  extends the box by an area
+            inline void add(Coordinate x, Coordinate y, Dimension w, Dimension h) {
+                x1 = std::min<int32_t>(x1, x);
+                y1 = std::min<int32_t>(y1, y);
+                x2 = std::max<int32_t>(x2, (int32_t) x + w);
+                y2 = std::max<int32_t>(y2, (int32_t) y + h);
+            }
+
+            inline bool empty() const { return (x2 <= x1) || (y2 <= y1); }
+
+            /// @brief  the box, an empty area if nothing has been added
+            RectArea get() const {
+                return empty() ? RectArea(Point(0, 0), Size(0, 0)) : RectArea(Point(x1, y1), Size(x2 - x1, y2 - y1));
+            }
+
+        protected:
+            int32_t x1 = INT32_MAX, y1 = INT32_MAX;
+            int32_t x2 = INT32_MIN, y2 = INT32_MIN;
+    };
+
+}
+
+#endif
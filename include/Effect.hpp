@@ -18,6 +18,13 @@
 #include <Shape.hpp>
 #include <TimeBase.hpp>
 #include <Log.hpp>
+#include <DirtyRegion.hpp>
+#include <Blend.hpp>
+#include <ParticleBudget.hpp>
+#include <FastRandom.hpp>
+#include <SoundSnapshot.hpp>
+
+#include <atomic>
 
 namespace prgbfx {
 
@@ -31,6 +38,14 @@ namespace prgbfx {
     // General use values for Direction
     enum Direction {DIR_Left, DIR_Right, DIR_Down, DIR_Up };
 
+    /// @brief Information the @link Scene @endlink passes to every effect before it is rendered
+    struct RenderContext {
+        DirtyRegion* dirty = nullptr;   /// areas drawn in this frame, nullptr if the scene does not track them
+        RawCanvas canvas;               /// the frame buffer, not valid if the LightArray does not provide it
+        ParticleBudget* particles = nullptr; /// shared by the particle effects of the scene, nullptr if there is no limit
+        const SoundSnapshot* sound = nullptr; /// the sound input of the frame, see @link SoundSource @endlink
+    };
+
     /// @brief Effects derived from this abstract class will paint the effect onto the "canvas" when called. The size of this canvas is defined by the @link prgb::Geometry @endlink of the @link prgb::LightArray @endlink
     class Effect {
         protected:
@@ -38,12 +53,77 @@ namespace prgbfx {
             bool enabled = true;
             LightArray* ar;
             TimeMS time_start; // \todo review
+            RenderContext* context = nullptr;
+            const char* name = nullptr;
+            FastRandom random = FastRandom(1, next_stream());  // random numbers of the effect, see seed_random()
+
+            /// @brief  the default stream of the next effect
+            static uint64_t next_stream() {
+                static std::atomic<uint64_t> streams{0};
+                return streams.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /// @brief  reports an area that has been drawn in this frame. Tileable effects must do this in prepare_frame()
+            inline void mark_dirty(const RectArea& area) { if (context && context->dirty) context->dirty->add(area); }
+
+            /// @brief  marks the bounding box of many small areas, e.g. of all particles drawn in a frame
+            inline void mark_dirty(const DirtyBounds& bounds) { if (!bounds.empty()) mark_dirty(bounds.get()); }
+
+            /// @brief  the dirty region to be passed to @link Shape::drawmod() @endlink
+            inline DirtyRegion* get_dirty_region() { return context ? context->dirty : nullptr; }
+
+            /// @brief  the frame buffer to blend into (see @link PixelBatch @endlink and @link Shape::drawmod() @endlink)
+            /// @return nullptr if the pixels have to be drawn using the LightArray
+            inline const RawCanvas* get_raw_canvas() { return (context && context->canvas.is_valid()) ? &context->canvas : nullptr; }
 
         public:
             Effect(LightArray* ar) : ar(ar) { LOG("Effect: Construct"); time_start=ar->get_timebase().get_deltatime_ms();};
             virtual ~Effect() { LOG("Effect: Destruct"); }
             
             virtual void render_effect(TimeMS time_delta) = 0;
+
+            /// @brief  Tileable effects split render_effect() into prepare_frame() (all state changes, called once per frame) and 
+            ///         render_tile() (pure drawing inside a clip rectangle). Only those effects can be rendered by multiple threads
+            /// @return true if the effect implements prepare_frame() and render_tile()
+            virtual bool is_tileable() { return false; }
+
+            /// @brief  updates the state of a tileable effect for the frame. Is called exactly once per frame before any render_tile() call
+            /// @param time_delta 
+            virtual void prepare_frame(TimeMS time_delta) {}
+
+            /// @brief  draws the part of a tileable effect which lies inside the clip rectangle. Must not change the state of the effect
+            ///         as it might be called from different threads at the same time. In that case the raw canvas (see get_raw_canvas())
+            ///         covers the clip rectangle and all pixels have to be written into it, the LightArray must not be called
+            /// @param time_delta 
+            /// @param clip only pixels inside this area may be drawn
+            virtual void render_tile(TimeMS time_delta, const RectArea& clip) {}
+
+            /// @brief  Effects that report every area they draw using mark_dirty() return true. For all others the scene
+            ///         assumes the entire canvas has been changed
+            virtual bool tracks_dirty() { return false; }
+
+            /// @brief  restarts the random numbers of the effect, the same seed and stream give the same frames. Without a seed
+            ///         each effect uses its own stream, so two effects of the same kind do not draw the same. Effects of a scene are
+            ///         seeded by @link Scene::seed_effects() @endlink
+            /// @param seed
+            /// @param stream different streams give independent random numbers for effects with the same seed
+            void seed_random(uint64_t seed, uint64_t stream = 0) { random.seed(seed, stream); }
+
+            /// @brief  sets the context of the current frame, called by the scene. Effects reading the sound pass context->sound to
+            ///         their @link SoundSource @endlink and to their color and position modifiers
+            virtual void set_context(RenderContext* context) { this->context = context; }
+
+            /// @brief  the class name of the effect, must be implemented by all derived classes that can be created
+            virtual const char* get_type_name() { return "Effect"; }
+
+            /// @brief  the name of the effect, e.g. used by the @link FrameProfiler @endlink
+            /// @return the name set by set_name(), the class name otherwise
+            const char* get_name() { return name ? name : get_type_name(); }
+
+            /// @brief  names the effect, e.g. to tell multiple effects of the same class apart
+            /// @param name must be valid as long as the effect exists, nullptr to use the class name
+            void set_name(const char* name) { this->name = name; }
+
             virtual bool has_ended() { return false; };
             void reset_start_time(TimeMS time_start) { this->time_start=time_start; };
             inline void disable() { enabled = false; }
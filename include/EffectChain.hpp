@@ -39,9 +39,20 @@ namespace prgbfx {
 
             virtual void add(Effect *effect) { 
                 LOG("EffectChain: Add effect"); 
+                if (seeded) effect->seed_random(seed, next_stream++);
                 effects.get()->push_back(effect); 
             }
 
+            /// @brief  seeds the random generators of all effects, each effect gets its own stream. Effects added later are seeded
+            ///         with the next streams, so the same seed gives the same frames if the effects are added in the same order
+            /// @param seed
+            void seed_effects(uint64_t seed) {
+                seeded = true;
+                this->seed = seed;
+                next_stream = 0;
+                for (auto e : *effects) e->seed_random(seed, next_stream++);
+            }
+
             std::vector<Effect *> *get_effects_list() { return effects.get(); }
 
             virtual inline void pre_frame(TimeMS delta_time) {}
@@ -52,6 +63,10 @@ namespace prgbfx {
             LightArray* ar;
             LoudnessBase& lb;
             SoundObserver& ob;
+
+            bool seeded = false;        // seed_effects() has been called
+            uint64_t seed = 0;
+            uint64_t next_stream = 0;
     };
 }
 
@@ -15,6 +15,9 @@
 
 #include <Color.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace prgbfx {
     using namespace prgb;
 
@@ -47,6 +50,42 @@ namespace prgbfx {
 
     };
 
+    /**
+     * @brief Remembers the colors calculated for one time stamp. All effects of a frame are rendered with the same time stamp, so an
+     *        @link EffectColor @endlink shared by several effects, or asked once per particle, calculates each color only once per frame.
+     *        The entries are selected by idx (direct mapped), an entry of an older frame is simply overwritten
+     */
+    class ColorCache {
+
+        public:
+            static const size_t cache_size = 4;
+
+            /// @brief  looks up the color of a time stamp and index
+            /// @return false if the color has not been calculated yet
+            inline bool find(TimeMS delta_ms, uint8_t idx, ColorValue& color) const {
+                const Entry& e = entries[idx % cache_size];
+                if (!e.valid || (e.time != delta_ms) || (e.idx != idx)) return false;
+                color = e.color;
+                return true;
+            }
+
+            inline void store(TimeMS delta_ms, uint8_t idx, ColorValue color) {
+                entries[idx % cache_size] = Entry({ delta_ms, idx, true, color });
+            }
+
+            /// @brief  forgets all colors, has to be called if the parameters of the color change
+            void clear() { for (auto& e : entries) e.valid = false; }
+
+        protected:
+            struct Entry {
+                TimeMS time = 0;
+                uint8_t idx = 0;
+                bool valid = false;
+                ColorValue color = 0;
+            };
+            Entry entries[cache_size];
+    };
+
     /**
      * @brief get_color() always returns the static color
      */
@@ -80,15 +119,53 @@ namespace prgbfx {
                 /// @brief the number of colors
                 uint8_t size;
 
+                /// @brief the colors calculated in the current frame, see @link ColorCache @endlink
+                ColorCache cache;
+
+                /// @brief number of colors of the transition from one palette color to the next
+                static const uint32_t gradient_steps = 1000;
+
+                /// @brief the transitions between all neighbouring colors of the palette (color i to i+1), gradient_steps colors
+                ///        each. Calculated when the palette is set, so get_color() never allocates memory while a frame is rendered
+                std::vector<ColorValue> texture;
+
+                /// @brief  has to be called after the palette has been changed
+                void palette_changed() {
+                    size = (colors != nullptr) ? colors->size() : 0;
+                    build_texture();
+                    cache.clear();
+                }
+
+                /// @brief  the color at step pos of the transition from palette color colorno to the next one, a single load
+                ///         from the texture
+                /// @param colorno 0..size-1
+                /// @param pos 0..gradient_steps-1
+                inline ColorValue get_gradient(uint8_t colorno, uint32_t pos) {
+                    return texture[(size_t) colorno * gradient_steps + std::min(pos, gradient_steps - 1)];
+                }
+
+                void build_texture() {
+                    texture.resize((size_t) size * gradient_steps);
+                    if (size == 0) return;
+                    const ColorPalette& colorv = *colors;
+                    for (uint32_t c = 0; c < size; c++) {
+                        ColorValue* t = &texture[(size_t) c * gradient_steps];
+                        for (uint32_t pos = 0; pos < gradient_steps; pos++) {
+                            t[pos] = prgb::gradient(colorv[c], colorv[(c+1)%size], pos, gradient_steps);
+                        }
+                    }
+                }
+
             public:
                 EffectColorPaletteAbstract(const ColorPalette *colors, TimeMS delay_ms, uint8_t offset = 0) 
                     : EffectColor(), colors(colors), delay_ms(delay_ms), offset(offset), size((colors != nullptr) ? colors->size() : 0) {
                     LOG(" EffectColorPaletteAbstract: Construct");
+                    build_texture();
                 }
 
-            /// @brief  replace the array of colors
+            /// @brief  replace the array of colors. Has to be called again if the colors of the palette are changed
             /// @param colors 
-            void set_colors(const ColorPalette *colors) { this->colors = colors; };
+            void set_colors(const ColorPalette *colors) { this->colors = colors; palette_changed(); };
 
             /// @brief  get_color is still abstract. Classes derived from this class can rely on the handling of the ColorPalette, the get_color
             ///         member function still needs to be overwritten
@@ -119,9 +196,29 @@ namespace prgbfx {
 
             virtual ~EffectColorMove() {LOG(" EffectColorMove: Destruct");}
 
-            /// calculates the color from the time 
+            /// @brief  the color at a point in time, calculated once per time stamp and index
             virtual ColorValue get_color(TimeMS delta_ms, uint8_t idx=0) {
-                if (colors == nullptr) return 0;
+                ColorValue color;
+                if (cache.find(delta_ms, idx, color)) return color;
+                color = calculate_color(delta_ms, idx);
+                cache.store(delta_ms, idx, color);
+                return color;
+            }
+
+            // resets the parameters to new values
+            void reset(const ColorPalette *colors, TimeMS delay_ms, uint8_t offset, ColorMoveMode mode, TimeMS fade_ms = 500) {
+                this->colors =colors;
+                this->delay_ms = delay_ms;
+                this->offset = offset;
+                this->mode = mode;
+                this->fade_ms = fade_ms;        
+                palette_changed();
+            }
+
+        protected:
+            /// calculates the color from the time 
+            ColorValue calculate_color(TimeMS delta_ms, uint8_t idx) {
+                if ((colors == nullptr) || (size == 0)) return 0;
                     
                 const ColorPalette& colorv = *colors;
                 if (size == 1) return (colorv[0]); // only one color -> nothing to calculate
@@ -136,25 +233,16 @@ namespace prgbfx {
                 switch (mode) {
                     case CMV_Crossfade:
                         perthousand = 1000*timepos / delay_ms; // where are we between two colors?
-                        return prgb::gradient(colorv[colorno],colorv[(colorno+1)%size], perthousand,1000);
+                        return get_gradient(colorno, perthousand);
                     case CMV_Softswitch:
                         perthousand = (timepos <= fadepointms) ? 0 : 1000*(timepos-fadepointms)/fade_ms;
-                        return prgb::gradient(colorv[colorno],colorv[(colorno+1)%size], perthousand,1000);
+                        return get_gradient(colorno, perthousand);
                     case CMV_Switch:
                         return colorv[colorno];
                     default: // CMV_None
                         return colorv[(offset+idx)%size];
                     };
             }
-
-            // resets the parameters to new values
-            void reset(const ColorPalette *colors, TimeMS delay_ms, uint8_t offset, ColorMoveMode mode, TimeMS fade_ms = 500) {
-                this->colors =colors;
-                this->delay_ms = delay_ms;
-                this->offset = offset;
-                this->mode = mode;
-                this->fade_ms = fade_ms;        
-            }
     };
 
 
@@ -0,0 +1,74 @@
+/**
+ * @file FastRandom.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief A small and fast random generator (PCG32) which is owned by each effect instead of the global state of rand()
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_FASTRANDOM_HPP
+#define PRGB_FASTRANDOM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace prgbfx {
+
+    /**
+     * @brief PCG32 generator (permuted congruential generator, 64 bit state, 32 bit output). The same seed and stream always give
+     *        the same sequence, different streams with the same seed give independent sequences. Not thread-safe, each effect
+     *        has its own generator
+     */
+    class FastRandom {
+
+        public:
+            FastRandom(uint64_t seed = 1, uint64_t stream = 0) { this->seed(seed, stream); }
+
+            /// @brief  restarts the sequence
+            /// @param seed
+            /// @param stream selects one of 2^63 independent sequences
+            void seed(uint64_t seed, uint64_t stream = 0) {
+                state = 0;
+                inc = (stream << 1) | 1;
+                next();
+                state += seed;
+                next();
+            }
+
+            /// @brief  the next 32 random bits
+            inline uint32_t next() {
+                uint64_t old = state;
+                state = old * 6364136223846793005ULL + inc;
+                uint32_t xorshifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+                uint32_t rot = (uint32_t) (old >> 59);
+                return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+            }
+
+            /// @brief  a random number from 0 to bound-1, without a division (the bias is below bound / 2^32)
+            /// @param bound must be > 0
+            inline uint32_t below(uint32_t bound) { return (uint32_t) (((uint64_t) next() * bound) >> 32); }
+
+            /// @brief  a random number from min to max-1
+            inline int32_t range(int32_t min, int32_t max) { return min + (int32_t) below((uint32_t) (max - min)); }
+
+            /// @brief  fills values with random numbers from 0 to bound-1, e.g. the positions of all particles spawned in a frame
+            void fill_below(uint32_t* values, size_t n, uint32_t bound) {
+                for (size_t i = 0; i < n; i++) values[i] = below(bound);
+            }
+
+            /// @brief  fills values with random numbers from min to max-1
+            void fill_range(int32_t* values, size_t n, int32_t min, int32_t max) {
+                for (size_t i = 0; i < n; i++) values[i] = range(min, max);
+            }
+
+        protected:
+            uint64_t state;
+            uint64_t inc;
+    };
+
+}
+
+#endif
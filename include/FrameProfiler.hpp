@@ -0,0 +1,227 @@
+/**
+ * @file FrameProfiler.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Measures how long the different parts of a frame take. The times are collected in histograms of fixed size, so
+ *        recording does not allocate any memory
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_FRAMEPROFILER_HPP
+#define PRGB_FRAMEPROFILER_HPP
+
+#include <Log.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace prgbfx {
+
+    class Effect;
+
+    /**
+     * @brief Histogram of durations in microseconds. Durations up to 7 us have their own bucket, above that each power of two is
+     *        split into 4 buckets, so the error of a percentile is below 25%. The last bucket starts at ~117 s and also counts all
+     *        durations above ~134 s.
+     */
+    class TimingHistogram {
+
+        public:
+            static const uint32_t bucket_count = 104;
+
+            /// @brief  adds a duration
+            /// @param us duration in microseconds
+            void add(uint32_t us) {
+                buckets[bucket_of(us)]++;
+                count++;
+                sum += us;
+                if (us > max) max = us;
+            }
+
+            void reset() {
+                buckets.fill(0);
+                count = 0;
+                sum = 0;
+                max = 0;
+            }
+
+            /// @brief  percentile of all durations added since the last reset
+            /// @param permille 500 for the median, 990 for p99
+            /// @return upper bound of the bucket containing the percentile in microseconds, 0 if empty
+            uint32_t get_percentile(uint16_t permille) const {
+                if (count == 0) return 0;
+                uint64_t rank = (count * permille + 999) / 1000;
+                if (rank == 0) rank = 1;
+                uint64_t seen = 0;
+                for (uint32_t i = 0; i < bucket_count; i++) {
+                    seen += buckets[i];
+                    if (seen >= rank) return std::min(upper_bound_of(i), max);
+                }
+                return max;
+            }
+
+            uint32_t get_p50() const { return get_percentile(500); }
+            uint32_t get_p99() const { return get_percentile(990); }
+            uint32_t get_max() const { return max; }
+            uint64_t get_count() const { return count; }
+            uint32_t get_avg() const { return (count == 0) ? 0 : (uint32_t)(sum / count); }
+
+        protected:
+            std::array<uint32_t, bucket_count> buckets {};
+            uint64_t count = 0;
+            uint64_t sum = 0;
+            uint32_t max = 0;
+
+            static uint32_t bucket_of(uint32_t us) {
+                if (us < 8) return us;
+                uint32_t e = 3;                             // position of the highest bit
+                while (us >> (e + 1)) e++;
+                uint32_t sub = (us >> (e - 2)) & 3;         // next two bits
+                uint32_t b = 8 + (e - 3) * 4 + sub;
+                return (b < bucket_count) ? b : bucket_count - 1;
+            }
+
+            static uint32_t upper_bound_of(uint32_t b) {
+                if (b < 8) return b;
+                uint32_t e = (b - 8) / 4 + 3;
+                uint32_t sub = (b - 8) % 4;
+                return (uint32_t)((((uint64_t)(4 + sub + 1)) << (e - 2)) - 1);
+            }
+    };
+
+    /**
+     * @brief Collects the timing of the parts of a frame: clearing the canvas, rendering each effect, committing the buffer and
+     *        analysing the sound. Effects are identified by their address, up to max_effects effects get their own histogram.
+     *        A new effect takes over the slot of the effect that has not been rendered for the longest time, if every slot has been
+     *        used in the current frame it is counted in a separate "(other)" slot (see get_other()). Scenes call end_effect() when
+     *        an effect leaves the chain, so an effect allocated at the same address later gets a slot of its own
+     */
+    class FrameProfiler {
+
+        public:
+            static const size_t max_effects = 32;
+
+            typedef std::chrono::steady_clock Clock;
+
+            /// @brief Statistics of a single effect
+            struct EffectTiming {
+                const Effect* effect = nullptr;
+                const char* name = "";
+                TimingHistogram render;
+                uint64_t last_frame = 0;        // number of the last frame the effect has been rendered in
+            };
+
+            TimingHistogram clear, commit, sound, tiles, frame;
+
+            /// @brief  microseconds elapsed since start
+            static uint32_t elapsed_us(Clock::time_point start) {
+                return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            }
+
+            /// @brief  adds the render time of an effect
+            /// @param e the effect
+            /// @param name name of the effect (see @link Effect::get_name() @endlink), used by get_label()
+            /// @param us duration
+            void add_effect(const Effect* e, const char* name, uint32_t us) {
+                uint64_t now = frame.get_count();
+                size_t i = 0;
+                while ((i < used) && (effects[i].effect != e)) i++;
+                if (i == used) {
+                    if (used < max_effects) {
+                        used++;
+                    } else {
+                        // no free slot, take the one that has not been rendered for the longest time, ended effects first
+                        i = 0;
+                        for (size_t j = 1; j < used; j++) {
+                            if ((effects[j].last_frame < effects[i].last_frame) ||
+                                ((effects[j].last_frame == effects[i].last_frame) && (effects[j].effect == nullptr))) i = j;
+                        }
+                        if (effects[i].last_frame == now) {
+                            other.render.add(us);
+                            return;
+                        }
+                    }
+                    effects[i] = EffectTiming();
+                    effects[i].effect = e;
+                    effects[i].name = name;
+                }
+                effects[i].last_frame = now;
+                effects[i].render.add(us);
+            }
+
+            /// @brief  the effect has left the chain, its statistics are kept until the slot is needed for another effect
+            void end_effect(const Effect* e) {
+                for (size_t i = 0; i < used; i++) if (effects[i].effect == e) effects[i].effect = nullptr;
+            }
+
+            /// @brief  forgets all effects, e.g. when a scene switches to another chain. The other parts of the frame are kept
+            void reset_effects() {
+                for (size_t i = 0; i < used; i++) effects[i] = EffectTiming();
+                used = 0;
+                other = EffectTiming();
+                other.name = "(other)";
+            }
+
+            size_t get_effect_count() const { return used; }
+            const EffectTiming& get_effect(size_t i) const { return effects[i]; }
+
+            /// @brief  the name of an effect followed by its slot, so effects with the same name can be told apart
+            std::string get_label(size_t i) const { return std::string(effects[i].name) + "#" + std::to_string(i); }
+
+            /// @brief  the effects that did not get a slot of their own
+            const EffectTiming& get_other() const { return other; }
+
+            /// @brief  finds the timing of an effect
+            /// @return nullptr if the effect has not been recorded
+            const EffectTiming* find_effect(const Effect* e) const {
+                for (size_t i = 0; i < used; i++) if (effects[i].effect == e) return &effects[i];
+                return nullptr;
+            }
+
+            /// @brief  the effect with the highest p99 render time
+            const EffectTiming* get_slowest_effect() const {
+                const EffectTiming* slowest = nullptr;
+                for (size_t i = 0; i < used; i++) {
+                    if ((slowest == nullptr) || (effects[i].render.get_p99() > slowest->render.get_p99())) slowest = &effects[i];
+                }
+                return slowest;
+            }
+
+            void reset() {
+                clear.reset(); commit.reset(); sound.reset(); tiles.reset(); frame.reset();
+                reset_effects();
+            }
+
+            /// @brief  writes the statistics to the log
+            void dump() const {
+                LOG("FrameProfiler: frames " + std::to_string(frame.get_count()));
+                log_line("frame", frame);
+                log_line("clear", clear);
+                log_line("tiles", tiles);
+                log_line("commit", commit);
+                log_line("sound", sound);
+                for (size_t i = 0; i < used; i++) log_line(get_label(i), effects[i].render);
+                log_line(other.name, other.render);
+            }
+
+        protected:
+            std::array<EffectTiming, max_effects> effects;
+            size_t used = 0;
+            EffectTiming other = { nullptr, "(other)", TimingHistogram(), 0 };
+
+            static void log_line(const std::string& label, const TimingHistogram& h) {
+                if (h.get_count() == 0) return;
+                LOG("  " + label + ": p50 " + std::to_string(h.get_p50()) + " us, p99 " + std::to_string(h.get_p99()) +
+                    " us, max " + std::to_string(h.get_max()) + " us, n " + std::to_string(h.get_count()));
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * @file OutputPipeline.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Commits frames on a dedicated output thread so the transfer to the lights does not add to the render time of the next frame
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_OUTPUTPIPELINE_HPP
+#define PRGB_OUTPUTPIPELINE_HPP
+
+#include <LightArray.hpp>
+#include <Log.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief Implemented by LightArrays with several frame buffers, which allow the next frame to be drawn while the previous ones
+     *        are committed. The render thread draws into one buffer, commit_buffer() commits the submitted buffers in the order
+     *        they have been drawn. commit_buffer() runs on the output thread at the same time as next_buffer() and the drawing
+     *        on the render thread, so they must not share any state without synchronization: e.g. each side keeps its own
+     *        buffer index (see MemoryLightArray in bench/StandIns.hpp)
+     */
+    class FrameBufferRing {
+        public:
+            virtual ~FrameBufferRing() {}
+
+            /// @brief  number of frame buffers
+            virtual size_t get_buffer_count() = 0;
+
+            /// @brief  switches the buffer the next frame is drawn into to the next one of the ring. Called by the render thread after
+            ///         a frame has been submitted, the first frame is drawn into the current buffer. The new buffer may still be
+            ///         committed, drawing into it only starts when it is done. A @link RawCanvasProvider @endlink returns this buffer
+            virtual void next_buffer() = 0;
+    };
+
+    /**
+     * @brief The OutputPipeline owns a thread which calls @link LightArray::commit_buffer() @endlink for each submitted frame.
+     *        The render thread submits a frame and continues with the next one. The depth limits the number of frames which
+     *        have been submitted but not yet committed: acquire() blocks while the queue is full, so the render thread never
+     *        runs away from a slow LED link. With a depth of 1 the next frame only starts drawing into the canvas when the previous
+     *        commit has finished (sound analysis and the frame hooks overlap with the transfer). A depth of 2 or more lets the next
+     *        frame render while the previous ones are transferred. This is only possible if the LightArray has a buffer for each
+     *        frame in flight and implements @link FrameBufferRing @endlink, otherwise the depth is limited to 1.
+     *        The pipeline measures the latency from submit() to the end of the commit and the duration of the commit itself.
+     */
+    class OutputPipeline {
+
+        public:
+            /// @brief starts the output thread
+            /// @param ar the array to be committed
+            /// @param depth maximum number of frames submitted but not yet committed, at most the number of buffers of the ring
+            /// @param ring the frame buffers of ar, without a ring the depth is 1
+            OutputPipeline(LightArray* ar, size_t depth, FrameBufferRing* ring = nullptr) : ar(ar), ring(ring), queue(limit_depth(depth, ring)) {
+                LOG("OutputPipeline: Construct");
+                output = std::thread([this]() { work(); });
+            }
+
+            /// @brief commits the frames still in the queue and stops the output thread
+            ~OutputPipeline() {
+                LOG("OutputPipeline: Destruct");
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    stopping = true;
+                }
+                cv_submit.notify_one();
+                output.join();
+            }
+
+            /// @brief  blocks until there is room for another frame in the queue. Must be called before the canvas is changed
+            void acquire() {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_commit.wait(lock, [this]() { return pending < queue.size(); });
+            }
+
+            /// @brief  hands the current content of the canvas over to the output thread
+            void submit() {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    queue[(head + pending) % queue.size()] = Clock::now();
+                    pending++;
+                }
+                // the next frame is drawn into the next buffer, acquire() waits until it has been committed
+                if (ring) ring->next_buffer();
+                cv_submit.notify_one();
+            }
+
+            /// @brief  blocks until all submitted frames have been committed
+            void drain() {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_commit.wait(lock, [this]() { return pending == 0; });
+            }
+
+            size_t get_depth() { return queue.size(); }
+
+            /// @brief  the frame buffers of the array, nullptr if the array has only one
+            FrameBufferRing* get_ring() { return ring; }
+
+            /// @brief  number of frames committed by the output thread
+            uint64_t get_committed_frames() { std::lock_guard<std::mutex> lock(mtx); return committed; }
+
+            /// @brief  time from submit() to the end of the commit of the last frame in microseconds
+            uint32_t get_latency_us() { std::lock_guard<std::mutex> lock(mtx); return latency_us; }
+
+            /// @brief  highest latency since the last call to reset_stats()
+            uint32_t get_max_latency_us() { std::lock_guard<std::mutex> lock(mtx); return latency_max_us; }
+
+            /// @brief  average latency since the last call to reset_stats()
+            uint32_t get_avg_latency_us() { std::lock_guard<std::mutex> lock(mtx); return (stat_count == 0) ? 0 : latency_sum_us / stat_count; }
+
+            /// @brief  duration of the last commit_buffer() call in microseconds
+            uint32_t get_commit_us() { std::lock_guard<std::mutex> lock(mtx); return commit_us; }
+
+            void reset_stats() {
+                std::lock_guard<std::mutex> lock(mtx);
+                latency_max_us = 0;
+                latency_sum_us = 0;
+                stat_count = 0;
+            }
+
+        protected:
+            typedef std::chrono::steady_clock Clock;
+
+            LightArray* ar;
+            FrameBufferRing* ring;
+            std::thread output;
+
+            std::mutex mtx;
+            std::condition_variable cv_submit, cv_commit;
+
+            // ring of submit timestamps, one per frame in flight
+            std::vector<Clock::time_point> queue;
+            size_t head = 0;
+            size_t pending = 0;
+            bool stopping = false;
+
+            uint64_t committed = 0;
+            uint32_t latency_us = 0, latency_max_us = 0, commit_us = 0;
+            uint64_t latency_sum_us = 0, stat_count = 0;
+
+            static size_t limit_depth(size_t depth, FrameBufferRing* ring) {
+                size_t max = ring ? ring->get_buffer_count() : 1;
+                return (depth < 1) ? 1 : (depth > max) ? max : depth;
+            }
+
+            static uint32_t elapsed_us(Clock::time_point from, Clock::time_point to) {
+                return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+            }
+
+            /// @brief  output thread: commit one frame after the other
+            void work() {
+                for (;;) {
+                    Clock::time_point submitted;
+                    {
+                        std::unique_lock<std::mutex> lock(mtx);
+                        cv_submit.wait(lock, [this]() { return stopping || pending > 0; });
+                        if (pending == 0) return; // stopping and nothing left to commit
+                        submitted = queue[head];
+                    }
+
+                    Clock::time_point start = Clock::now();
+                    ar->commit_buffer();
+                    Clock::time_point end = Clock::now();
+
+                    {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        head = (head + 1) % queue.size();
+                        pending--;
+                        committed++;
+                        commit_us = elapsed_us(start, end);
+                        latency_us = elapsed_us(submitted, end);
+                        if (latency_us > latency_max_us) latency_max_us = latency_us;
+                        latency_sum_us += latency_us;
+                        stat_count++;
+                    }
+                    cv_commit.notify_all();
+                }
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file ParticleArray.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief A container for particles with a fixed capacity. Each field of the particles is stored in its own contiguous
+ *        array (structure of arrays), so a pass over one field only touches the memory of this field
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_PARTICLEARRAY_HPP
+#define PRGB_PARTICLEARRAY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace prgbfx {
+
+    /**
+     * @brief Stores up to capacity particles, particle i consists of get<0>()[i], get<1>()[i], ... The memory for all
+     *        particles is allocated by the constructor, adding and removing particles never allocates memory (unless the fields
+     *        allocate memory themselves). Use an enum to name the fields, e.g. get<SPARK_Color>()
+     *
+     * @tparam Fields types of the fields, must be move assignable
+     */
+    template <typename... Fields>
+    class ParticleArray {
+
+        public:
+            ParticleArray(size_t capacity) : capacity(capacity) {
+                std::apply([capacity](auto&... a) { (a.reserve(capacity), ...); }, arrays);
+            }
+
+            inline size_t size() const { return std::get<0>(arrays).size(); }
+            inline size_t get_capacity() const { return capacity; }
+            inline bool empty() const { return size() == 0; }
+            inline bool is_full() const { return size() >= capacity; }
+
+            /// @brief  the array of a field, valid until the particle array is destroyed
+            template <size_t I> inline auto* get() { return std::get<I>(arrays).data(); }
+            template <size_t I> inline const auto* get() const { return std::get<I>(arrays).data(); }
+
+            /// @brief  adds a particle at the end
+            /// @return false if the array is full, the particle is not added
+            bool add(Fields... values) {
+                if (is_full()) return false;
+                add_fields(std::index_sequence_for<Fields...>(), std::move(values)...);
+                return true;
+            }
+
+            /// @brief  removes particle i by moving the last particle into its place (swap and pop). This changes the order of
+            ///         the particles, for_each() removes particles without changing the order
+            void remove(size_t i) {
+                size_t last = size() - 1;
+                if (i != last) move_particle(std::index_sequence_for<Fields...>(), i, last);
+                std::apply([](auto&... a) { (a.pop_back(), ...); }, arrays);
+            }
+
+            void clear() { std::apply([](auto&... a) { (a.clear(), ...); }, arrays); }
+
+            /// @brief  removes the first n particles, which are the oldest ones if the order has not been changed by remove()
+            void remove_front(size_t n) {
+                n = std::min(n, size());
+                std::apply([n](auto&... a) { (a.erase(a.begin(), a.begin() + n), ...); }, arrays);
+            }
+
+            /**
+             * @brief Calls keep(i) for each particle in the order they have been added. keep returns false if the particle is not
+             *        used anymore. The remaining particles are moved together in the same pass, so their order does not change
+             *        and overlapping particles are drawn in the same order in every frame
+             *
+             * @tparam F bool(size_t i), a lambda is inlined
+             */
+            template <typename F>
+            void for_each(F&& keep) {
+                size_t n = size(), w = 0;
+                for (size_t i = 0; i < n; i++) {
+                    if (!keep(i)) continue;
+                    if (w != i) move_particle(std::index_sequence_for<Fields...>(), w, i);
+                    w++;
+                }
+                std::apply([w](auto&... a) { (a.erase(a.begin() + w, a.end()), ...); }, arrays);
+            }
+
+        protected:
+            size_t capacity;
+            std::tuple<std::vector<Fields>...> arrays;
+
+            template <size_t... I>
+            inline void add_fields(std::index_sequence<I...>, Fields&&... values) {
+                (std::get<I>(arrays).push_back(std::move(values)), ...);
+            }
+
+            template <size_t... I>
+            inline void move_particle(std::index_sequence<I...>, size_t dst, size_t src) {
+                ((std::get<I>(arrays)[dst] = std::move(std::get<I>(arrays)[src])), ...);
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file ParticleBudget.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Limits for the number of particles of an effect and of the entire scene, and counters to see how often they are hit
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_PARTICLEBUDGET_HPP
+#define PRGB_PARTICLEBUDGET_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace prgbfx {
+
+    /**
+     * @brief What happens if new particles do not fit into the budget
+     */
+    enum DropPolicy {
+        DROP_New,           /// the new particles are not added
+        DROP_Oldest,        /// the oldest particles are removed to make room for the new ones
+        DROP_ThinOut        /// particles of all ages are removed evenly to make room for the new ones
+    };
+
+    /**
+     * @brief Counters of a particle effect or of a scene. spawned and dropped count since the start, live is the current number
+     */
+    struct ParticleStats {
+        uint64_t spawned = 0;   /// particles added
+        uint64_t dropped = 0;   /// particles not added or removed early because of the budget
+        size_t live = 0;        /// particles alive after the last frame
+
+        void add(const ParticleStats& other) {
+            spawned += other.spawned;
+            dropped += other.dropped;
+            live += other.live;
+        }
+    };
+
+    /**
+     * @brief The number of particles all effects of a scene may have together. The scene resets the budget at the start of each
+     *        frame, then each particle effect claims the particles it has (or wants to have) in the order of the effect chain.
+     *        Effects earlier in the chain are served first
+     */
+    class ParticleBudget {
+
+        public:
+            ParticleBudget(size_t max_particles = SIZE_MAX) : max_particles(max_particles) {}
+
+            void set_max(size_t max_particles) { this->max_particles = max_particles; }
+            size_t get_max() const { return max_particles; }
+
+            /// @brief  called by the scene at the start of each frame
+            void reset() { claimed = 0; }
+
+            /// @brief  claims particles for this frame
+            /// @param wanted
+            /// @return the number of particles granted, less than wanted if the budget is exhausted
+            size_t claim(size_t wanted) {
+                size_t granted = std::min(wanted, max_particles - std::min(claimed, max_particles));
+                claimed += granted;
+                if (granted < wanted) denied++;
+                return granted;
+            }
+
+            /// @brief  particles claimed in this frame
+            size_t get_claimed() const { return claimed; }
+
+            /// @brief  number of claims that could not be granted completely
+            uint64_t get_denied() const { return denied; }
+
+        protected:
+            size_t max_particles;
+            size_t claimed = 0;
+            uint64_t denied = 0;
+    };
+
+}
+
+#endif
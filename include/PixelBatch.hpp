@@ -0,0 +1,97 @@
+/**
+ * @file PixelBatch.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Collects single pixels drawn by an effect (e.g. particles) and blends them with the kernels of @link Blend.hpp @endlink
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_PIXELBATCH_HPP
+#define PRGB_PIXELBATCH_HPP
+
+#include <Blend.hpp>
+#include <LightArray.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief Pixels added to the batch are blended into the @link RawCanvas @endlink when the batch is full or flush() is called.
+     *        The result is the same as calling set_pixel() for each pixel in the order they have been added. Without a raw canvas
+     *        add() simply calls set_pixel()
+     */
+    class PixelBatch {
+
+        public:
+            PixelBatch(size_t capacity = 256) : capacity(capacity), index(capacity), colors(capacity), opacity(capacity) {}
+
+            /// @brief  starts a batch, all pixels until the next flush() use the same mode
+            /// @param ar used if canvas is nullptr
+            /// @param canvas the frame buffer, may be nullptr
+            /// @param mode CMODE_Transparent or CMODE_Alpha
+            void begin(LightArray* ar, const RawCanvas* canvas, ColorMode mode) {
+                flush();
+                this->ar = ar;
+                this->canvas = canvas;
+                this->mode = mode;
+            }
+
+            /// @brief  adds a pixel, pixels outside the canvas are ignored
+            /// @param opacity only used for CMODE_Transparent
+            inline void add(Point pt, ColorValue color, int8_t opacity = 100) {
+                if (canvas == nullptr) { ar->set_pixel(pt, color, mode, opacity); return; }
+                if ((pt.x < 0) || (pt.y < 0) || (pt.x >= canvas->width) || (pt.y >= canvas->height)) return;
+                index[count] = (uint32_t) ((size_t) pt.y * canvas->stride + pt.x);
+                colors[count] = color;
+                this->opacity[count] = opacity;
+                if (++count == capacity) flush();
+            }
+
+            /// @brief  adds a cross of five pixels, the center and its four neighbours, without checking each pixel
+            /// @param color color of the center
+            /// @param color_outer color of the neighbours
+            /// @return false if nothing has been added because there is no raw canvas or the cross is not completely inside it
+            inline bool add_cross(Point pt, ColorValue color, ColorValue color_outer, int8_t opacity = 100) {
+                if ((canvas == nullptr) || (capacity < 5)) return false;
+                if ((pt.x < 1) || (pt.y < 1) || (pt.x >= canvas->width - 1) || (pt.y >= canvas->height - 1)) return false;
+                if (count + 5 > capacity) flush();
+                uint32_t center = (uint32_t) ((size_t) pt.y * canvas->stride + pt.x);
+                uint32_t stride = (uint32_t) canvas->stride;
+                uint32_t* idx = &index[count];
+                idx[0] = center; idx[1] = center - 1; idx[2] = center + 1; idx[3] = center + stride; idx[4] = center - stride;
+                ColorValue* col = &colors[count];
+                col[0] = color; col[1] = color_outer; col[2] = color_outer; col[3] = color_outer; col[4] = color_outer;
+                std::fill_n(&this->opacity[count], 5, opacity);
+                count += 5;
+                if (count == capacity) flush();
+                return true;
+            }
+
+            /// @brief  blends all collected pixels
+            void flush() {
+                if (count > 0) blend_pixels(canvas->pixels, index.data(), colors.data(), opacity.data(), count, mode);
+                count = 0;
+            }
+
+        protected:
+            size_t capacity;
+            size_t count = 0;
+            std::vector<uint32_t> index;
+            std::vector<ColorValue> colors;
+            std::vector<int8_t> opacity;
+
+            LightArray* ar = nullptr;
+            const RawCanvas* canvas = nullptr;
+            ColorMode mode = CMODE_Transparent;
+    };
+
+}
+
+#endif
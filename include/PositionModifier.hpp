@@ -14,8 +14,11 @@
 
 #include <TimeBase.hpp>
 #include <LoudnessBase.hpp>
+#include <SoundSnapshot.hpp>
 #include <Limiter.hpp>
 
+#include <typeinfo>
+
 namespace prgbfx {
 
     using namespace prgb;
@@ -23,6 +26,8 @@ namespace prgbfx {
     /**
      * @brief Effect that use the PositionModifier can use modifiers derived from this class to
      *        modify position and/or size of the rectangular area used by an effect.
+     *        Everything that only depends on the time (and the sound) is calculated by update() once per time stamp, so all shapes
+     *        sharing a modifier see the same state. calc_shape() and apply() only transform the areas
      */
     class PositionModifier {
         public:
@@ -34,13 +39,63 @@ namespace prgbfx {
                 };
             };
             virtual ~PositionModifier() {LOG("PositionModifier: Destruct");};
+
+            /// @brief  calls update() if the time stamp has changed since the last call
+            inline void prepare(TimeMS time_delta) {
+                if (prepared && (time_delta == time_prepared)) return;
+                prepared = true;
+                time_prepared = time_delta;
+                update(time_delta);
+            }
+
+            /// @brief  modifiers depending on the sound read the sound input of the frame from this snapshot. The effect owning
+            ///         the modifier passes the snapshot of its @link RenderContext @endlink, see @link set_sound_snapshots() @endlink
+            /// @param snapshot nullptr to read the sound directly
+            virtual void set_sound_snapshot(const SoundSnapshot* snapshot) {}
+
+            /// @brief  modifies n areas, one virtual call for all of them. Calls calc_shape() for each area, so a modifier which only
+            ///         overrides calc_shape() works as well. Modifiers override apply() with apply_each() to avoid the virtual calls
+            virtual void apply(TimeMS time_delta, RectArea* areas, size_t n) {
+                for (size_t i = 0; i < n; i++) areas[i] = calc_shape(time_delta, areas[i].origin, areas[i].size);
+            }
+
         protected:
             LightArray* ar;
+            bool prepared = false;
+            TimeMS time_prepared = 0;
+
+            /// @brief  calculates the state of the modifier for a time stamp, called by prepare()
+            virtual void update(TimeMS time_delta) {}
+
+            /// @brief  calls calc_shape() of the class M without a virtual call, used by the implementations of apply(). If the
+            ///         modifier is derived from M, its own calc_shape() is called
+            template <typename M>
+            static inline void apply_each(M* modifier, TimeMS time_delta, RectArea* areas, size_t n) {
+                if (typeid(*modifier) != typeid(M)) { modifier->PositionModifier::apply(time_delta, areas, n); return; }
+                for (size_t i = 0; i < n; i++) areas[i] = modifier->M::calc_shape(time_delta, areas[i].origin, areas[i].size);
+            }
     };
 
     typedef PositionModifier PositionModifierStatic;
     typedef std::vector<PositionModifier *> PositionModifiers;
 
+    /// @brief  passes the sound snapshot of the frame to all modifiers
+    inline void set_sound_snapshots(const PositionModifiers& posmods, const SoundSnapshot* snapshot) {
+        for (auto pos : posmods) pos->set_sound_snapshot(snapshot);
+    }
+
+    /// @brief  applies a chain of modifiers to n areas, each modifier is prepared once and called once for all areas
+    /// @param posmods 
+    /// @param time_delta 
+    /// @param areas modified in place
+    /// @param n 
+    inline void apply_position_modifiers(const PositionModifiers& posmods, TimeMS time_delta, RectArea* areas, size_t n) {
+        for (auto pmod : posmods) {
+            pmod->prepare(time_delta);
+            pmod->apply(time_delta, areas, n);
+        }
+    }
+
 /*    class PositionModifierLinearMotion : public PositionModifier {
         
         public:
@@ -84,29 +139,40 @@ namespace prgbfx {
             virtual ~PositionModifierSine() {LOG(" PositionModifierSine: Destruct");}
             virtual RectArea calc_shape(TimeMS time_delta, Point origin, Size size) 
                 { 
+                    prepare(time_delta);
                     Point origin_mod = origin;
                     if (delay_x_ms != 0) {
                         Dimension width = box.size.w - size.w; 
-
-                        TimeMS calctime = time_delta+delay_x_ms*(0 - box.origin.x)/box.size.w;
-
-                        int16_t idx = (deg_x/4+(calctime % delay_x_ms)*90/delay_x_ms) % 90;
-
-                        origin_mod.x =sine[idx]*width/200+width/2; 
+                        origin_mod.x =sine_x*width/200+width/2; 
                     }
                     if (delay_y_ms != 0) {
                         Dimension height = box.size.h - size.h;
-                        int16_t idx = (deg_y/4+(time_delta % delay_y_ms)*90/delay_y_ms) % 90;
-                        origin_mod.y=sine[idx]*height/200+height/2; 
+                        origin_mod.y=sine_y*height/200+height/2; 
                     }
                     return(RectArea(origin_mod,size));
                 } 
 
+            virtual void apply(TimeMS time_delta, RectArea* areas, size_t n) { apply_each(this, time_delta, areas, n); }
+
+        protected:
+            virtual void update(TimeMS time_delta) {
+                if (delay_x_ms != 0) {
+                    TimeMS calctime = time_delta+delay_x_ms*(0 - box.origin.x)/box.size.w;
+                    int16_t idx = (deg_x/4+(calctime % delay_x_ms)*90/delay_x_ms) % 90;
+                    sine_x = sine[idx];
+                }
+                if (delay_y_ms != 0) {
+                    int16_t idx = (deg_y/4+(time_delta % delay_y_ms)*90/delay_y_ms) % 90;
+                    sine_y = sine[idx];
+                }
+            }
+
         private:
             // Point initial;
             int16_t deg_x, deg_y;
             TimeMS delay_x_ms, delay_y_ms;
             RectArea box;
+            int32_t sine_x = 0, sine_y = 0;     // the positions of the current time stamp
     };
 
     enum SizeLoudnessMode : uint8_t { SIZELD_Static, SIZELD_Beginning, SIZELD_Center, SIZELD_End };
@@ -122,19 +188,18 @@ namespace prgbfx {
         
             virtual ~PositionModifierSizeLoudness() {LOG(" PositionModifierSizeLoudness: Destruct");}
 
+            /// @brief  reads the sound input of the frame from a snapshot, see @link Scene::get_sound_snapshot() @endlink
+            virtual void set_sound_snapshot(const SoundSnapshot* snapshot) { sound.set_snapshot(snapshot); }
+
             RectArea calc_shape(TimeMS time_delta, Point origin, Size size) {
+                prepare(time_delta);
                 Point origin_mod = origin;
                 Size size_mod = size;
 
-                Loudness 
-                    loud = lb.get_loudness(ldmode);
-
-                if (!lb.is_silent()) {
-                    Loudness ld_ref = sft_ld_ref.value(time_delta,loud);
-
+                if (!silent) {
                     if (slmodew != SIZELD_Static)
                     {            
-                        Dimension w = sft_ld_w.normalized(time_delta,loud,ld_ref,size_mod.w);
+                        Dimension w = normalize(level_w, size_mod.w);
 
                         switch (slmodew) {
                             case SIZELD_Center:
@@ -150,7 +215,7 @@ namespace prgbfx {
                     }
 
                     if (slmodeh != SIZELD_Static) {
-                        Dimension h = ldsofth.normalized(time_delta,loud,ld_ref,size_mod.h);
+                        Dimension h = normalize(level_h, size_mod.h);
 
                         switch (slmodeh) {
                             case SIZELD_Center:
@@ -170,12 +235,33 @@ namespace prgbfx {
                 return RectArea(origin_mod, size_mod);
             };
 
+            virtual void apply(TimeMS time_delta, RectArea* areas, size_t n) { apply_each(this, time_delta, areas, n); }
+
         protected:
             LoudnessBase& lb;
+            SoundSource sound = SoundSource(lb);
             LoudnessMode ldmode;
             SizeLoudnessMode slmodew, slmodeh;
             TimeMS glow;
 
+            // the state of the current time stamp, the softeners are updated once per time stamp
+            bool silent = true;
+            Loudness ld_ref = 0, level_w = 0, level_h = 0;
+
+            virtual void update(TimeMS time_delta) {
+                Loudness loud = sound.get_loudness(ldmode);
+                silent = sound.is_silent();
+                if (silent) return;
+                ld_ref = sft_ld_ref.value(time_delta,loud);
+                if (slmodew != SIZELD_Static) level_w = sft_ld_w.value(time_delta,loud);
+                if (slmodeh != SIZELD_Static) level_h = ldsofth.value(time_delta,loud);
+            }
+
+            /// @brief  the softened level relative to the reference, scaled to max (like Softener::normalized())
+            inline Dimension normalize(Loudness level, Dimension max) const {
+                return (ld_ref != 0) ? (Dimension) ((int32_t) level*max/ld_ref) : 0;
+            }
+
             Softener<Loudness> sft_ld_ref = Softener<Loudness> (60000);
             Softener<Loudness> sft_ld_w = Softener<Loudness>(glow), ldsofth = Softener<Loudness>(glow);
 
@@ -189,6 +275,8 @@ class PositionModifierResize : public PositionModifier {
             Dimension new_h = (size.h+size_delta.h > size_min.h) ? size.h + size_delta.h : 0;
             return (RectArea(origin,Size(new_w,new_h)));
         }
+
+        virtual void apply(TimeMS time_delta, RectArea* areas, size_t n) { apply_each(this, time_delta, areas, n); }
     protected:
         Size size_delta, size_min;
 };
@@ -206,6 +294,8 @@ class PositionModifierResize : public PositionModifier {
                 
                 return RectArea(origin,size_new);
             }
+
+            virtual void apply(TimeMS time_delta, RectArea* areas, size_t n) { apply_each(this, time_delta, areas, n); }
             virtual ~PositionModifierMinSize() {LOG(" PositionModifierMinSize: Construct");}
 
         protected:
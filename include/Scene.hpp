@@ -16,11 +16,19 @@
 
 #include <LightArray.hpp>
 #include <Effect.hpp>
+#include <EffectChain.hpp>
 #include <TimeBase.hpp>
 #include <SoundObserver.hpp>
+#include <TilePool.hpp>
+#include <OutputPipeline.hpp>
+#include <DirtyRegion.hpp>
+#include <FrameProfiler.hpp>
+#include <SoundRecorder.hpp>
+#include <SoundSnapshot.hpp>
 
 
 #include <list>
+#include <memory>
 
 /**
  * @brief The prgbfx namespace contains classes to implement an effect generator. It relies on classes 
@@ -42,21 +50,100 @@ namespace prgbfx {
 
                 LoudnessBase& lb;
                 SoundObserver observe = SoundObserver(lb,tb);
+                SoundSnapshot snapshot;         // the sound input of the current frame, see SoundSource
 
                 uint64_t frames = 0;
 
                 bool bStop = false;
 
+                // multi-threaded rendering, only used if set_render_threads() has been called with more than one thread
+                std::unique_ptr<TilePool> pool;
+                std::vector<Effect *> tile_batch;
+
+                // pipelined output, only used if set_pipeline_depth() has been called with a depth > 0
+                std::unique_ptr<OutputPipeline> output;
+
+                RenderContext context;
+                RawCanvasProvider* raw_canvas = nullptr;
+
+                // dirty rectangle tracking, only used if set_dirty_tracking(true) has been called
+                bool track_dirty = false;
+                bool clear_all = true;          // the next frame has to clear the entire canvas
+                DirtyRegion dirty_now;          // drawn in this frame
+                DirtyRegion dirty_last;         // drawn in the last frame
+                DirtyRegion dirty_changed;      // pixels that differ from the last frame, cleared at the start of the next frame
+
+                // profiling, only used if set_profiling(true) has been called
+                bool profiling = false;
+                FrameProfiler profiler;
+                TimeMS profile_dump_ms = 0;
+                TimeMS profile_last_dump = 0;
+
+                SoundRecorder* recorder = nullptr;
+
+                // scene-wide particle limit, only used if set_particle_budget() has been called
+                ParticleBudget particle_budget;
+
+                /// @brief  clears the canvas, only the changed areas if dirty tracking is active
+                void clear_canvas() {
+                    if (track_dirty && !clear_all) {
+                        for (size_t i = 0; i < dirty_changed.size(); i++) ar->fill_rect(dirty_changed[i], RGBA(0,0,0,255), CMODE_Set);
+                    } else {
+                        ar->fill_all(RGBA(0,0,0,255));
+                    }
+                    clear_all = false;
+                    dirty_now.clear();
+                }
+
+                /// @brief  renders the collected tileable effects in parallel. Inside each tile the effects are drawn in the order of the chain
+                ///         so the result is the same as drawing them one after another. post_effect() is called for the collected effects
+                ///         when they have been drawn
+                void flush_tiles(TimeMS delta) {
+                    if (tile_batch.empty()) return;
+                    FrameProfiler::Clock::time_point t_tiles;
+                    if (profiling) t_tiles = FrameProfiler::Clock::now();
+                    pool->run([this, delta](const RectArea& clip) {
+                        for (auto e : tile_batch) e->render_tile(delta, clip);
+                    });
+                    if (profiling) profiler.tiles.add(FrameProfiler::elapsed_us(t_tiles));
+                    for (auto e : tile_batch) post_effect(delta, e);
+                    tile_batch.clear();
+                }
+
             public:
-                Scene(LightArray* ar, TimeBase& tb, LoudnessBase& lb): tb(tb),ar(ar),lb(lb) { LOG("Scene: Construct");};
-                ~Scene() { LOG("Scene: Destruct");};
+                Scene(LightArray* ar, TimeBase& tb, LoudnessBase& lb): tb(tb),ar(ar),lb(lb) { 
+                    LOG("Scene: Construct");
+                    context.sound = &snapshot;
+                    observe.set_sound_snapshot(&snapshot);
+                };
+                ~Scene() { 
+                    LOG("Scene: Destruct");
+                };
 
                 /// @brief runs the scene and calculates the frames. Calls PreFrame, PreEffect, PostEffect, PreCommit, PostFrame which may be
                 ///        implemented in derived classes to do specific actions during the run. runScene needs to be run in an infinite loop
                 ///        that checks is_stopped(). runScene uses the active EffectChain
                 void runScene() {
-                    ar->fill_all(RGBA(0,0,0,255));
+                    typedef FrameProfiler::Clock Clock;
+                    Clock::time_point t_frame, t_part;
+
+                    if (output) {
+                        output->acquire(); // wait until the output thread allows changing the canvas
+                        // dirty tracking only covers the last two frames, a ring of more buffers has older content
+                        if (output->get_ring() && (output->get_ring()->get_buffer_count() > 2)) clear_all = true;
+                    }
+                    if (profiling) t_frame = t_part = Clock::now();
+                    clear_canvas();
+                    if (profiling) profiler.clear.add(FrameProfiler::elapsed_us(t_part));
+                    context.canvas = raw_canvas ? raw_canvas->get_raw_canvas() : RawCanvas();
+                    // the tiles only write into the raw canvas, the LightArray itself is never called by more than one thread
+                    Size canvas_size = ar->get_geometry().get_canvas_size();
+                    bool tiled = pool && context.canvas.is_valid() && (context.canvas.width >= canvas_size.w) && (context.canvas.height >= canvas_size.h);
+                    particle_budget.reset();
                     TimeMS delta = tb.get_deltatime_ms();
+                    if (recorder) delta = recorder->record_frame().time; // the replay must see the same timestamp
+                    snapshot.capture(lb, tb);   // all effects and the observer read the sound input of this frame from here
+                    observe.latch();            // the results of the analysis thread stay the same during the frame
 
                     pre_frame(delta);
                     fx_chain->pre_frame(delta);
@@ -65,22 +152,155 @@ namespace prgbfx {
                     for (std::vector<Effect *>::iterator it = fx_list->begin(); it != fx_list->end(); ) {
                         Effect *e = *it;
                         pre_effect(delta,e);
-                        e->render_effect(delta);
-                        if (e->has_ended()) { it = fx_list->erase(it); } else { ++it; }
-                        post_effect(delta,e);
+                        e->set_context(&context);
+                        if (track_dirty && !e->tracks_dirty()) dirty_now.add_all();
+                        if (profiling) t_part = Clock::now();
+                        bool batched = tiled && e->is_tileable();
+                        if (batched) {
+                            // state changes happen here, drawing and post_effect() are deferred until a non-tileable effect or the end of the chain
+                            e->prepare_frame(delta);
+                            tile_batch.push_back(e);
+                        } else {
+                            if (pool) flush_tiles(delta);
+                            if (profiling) t_part = Clock::now(); // the tiles are not part of this effect
+                            e->render_effect(delta);
+                        }
+                        if (profiling) profiler.add_effect(e, e->get_name(), FrameProfiler::elapsed_us(t_part));
+                        if (e->has_ended()) { profiler.end_effect(e); it = fx_list->erase(it); } else { ++it; }
+                        if (!batched) post_effect(delta,e);
                     }
+                    if (pool) flush_tiles(delta);
 
                     frames++;
                     pre_commit(delta);
-                    ar->commit_buffer();
+                    if (track_dirty) {
+                        // what has been drawn now and what has been drawn in the last frame (and is cleared now) has changed.
+                        // The next frame clears both, so a LightArray swapping two buffers is cleared correctly as well
+                        dirty_changed.clear();
+                        dirty_changed.add(dirty_now);
+                        dirty_changed.add(dirty_last);
+                        dirty_last = dirty_now;
+                    }
+                    if (profiling) t_part = Clock::now();
+                    if (output) output->submit(); else commit_frame(track_dirty ? &dirty_changed : nullptr);
+                    if (profiling) profiler.commit.add(FrameProfiler::elapsed_us(t_part));
 
-                    // collect sound data into the observer
-                    observe.collect_sound_data(delta);
+                    // collect sound data into the observer, unless it has its own thread
+                    if (!observe.is_async()) {
+                        if (profiling) t_part = Clock::now();
+                        observe.collect_sound_data(delta);
+                        if (profiling) profiler.sound.add(FrameProfiler::elapsed_us(t_part));
+                    }
 
                     post_frame(delta);
                     fx_chain->post_frame(delta);
+
+                    if (profiling) {
+                        profiler.frame.add(FrameProfiler::elapsed_us(t_frame));
+                        if ((profile_dump_ms > 0) && (delta - profile_last_dump >= profile_dump_ms)) {
+                            profile_last_dump = delta;
+                            profiler.dump();
+                        }
+                    }
                 };
 
+                /// @brief  switches to multi-threaded rendering. Tileable effects (see @link Effect::is_tileable() @endlink) are drawn
+                ///         in bands of rows by a pool of threads, all other effects are still drawn by the thread calling runScene().
+                ///         The output is the same as in single-threaded mode, commit_buffer() is still called once per frame.
+                ///         The threads only write into the raw canvas (see set_raw_canvas()), as LightArray implementations are not
+                ///         required to allow concurrent calls. Without a raw canvas covering the entire canvas all effects are drawn
+                ///         by the thread calling runScene()
+                /// @param threads number of threads including the calling thread, 0 or 1 switch back to single-threaded rendering
+                /// @param tile_rows height of the bands
+                void set_render_threads(unsigned threads, Dimension tile_rows = 8) {
+                    if (threads < 2) { pool.reset(); return; }
+                    pool = std::make_unique<TilePool>(threads);
+                    pool->split(ar->get_geometry().get_canvas(), tile_rows);
+                    tile_batch.reserve(16);
+                }
+
+                /// @brief  switches to pipelined output: commit_buffer() is called by an output thread while this thread continues with
+                ///         the sound analysis and the next frame. See @link OutputPipeline @endlink for the meaning of depth
+                /// @param depth maximum number of frames in flight, 0 switches back to committing in runScene()
+                /// @param ring the frame buffers of the array, required for a depth > 1 (the depth is limited to the number of buffers)
+                void set_pipeline_depth(size_t depth, FrameBufferRing* ring = nullptr) {
+                    output.reset(); // commits the remaining frames
+                    if (depth > 0) output = std::make_unique<OutputPipeline>(ar, depth, ring);
+                }
+
+                /// @brief  runs the sound analysis on its own thread at a fixed rate instead of once per frame in runScene(), so it does
+                ///         not add to the render time and is not sampled at the frame rate. See @link SoundObserver::start_async() @endlink
+                /// @param interval time between two analysis steps in ms, 0 switches back to the analysis in runScene()
+                void set_sound_analysis_interval(TimeMS interval) {
+                    if (interval > 0) observe.start_async(interval); else observe.stop_async();
+                }
+
+                /// @brief  the output pipeline for latency measurements
+                /// @return nullptr if pipelined output is not active
+                OutputPipeline* get_output_pipeline() { return output.get(); }
+
+                /// @brief  switches dirty rectangle tracking on or off. If active, effects report the areas they draw, only those areas
+                ///         are cleared in the next frame and the changed areas are passed to commit_frame(). Effects which do not
+                ///         report their areas (see @link Effect::tracks_dirty() @endlink) mark the entire canvas
+                /// @param active 
+                void set_dirty_tracking(bool active) {
+                    track_dirty = active;
+                    clear_all = true;
+                    RectArea canvas = ar->get_geometry().get_canvas();
+                    dirty_now.set_bounds(canvas);
+                    dirty_last.set_bounds(canvas);
+                    dirty_changed.set_bounds(canvas);
+                    context.dirty = active ? &dirty_now : nullptr;
+                }
+
+                /// @brief  the areas that changed in the last frame
+                /// @return nullptr if dirty tracking is not active
+                const DirtyRegion* get_changed_region() { return track_dirty ? &dirty_changed : nullptr; }
+
+                /// @brief  switches the profiler on or off. The profiler measures clearing the canvas, each effect, the tiles of
+                ///         multi-threaded rendering, the commit and the sound analysis. In multi-threaded mode the time of a tileable effect
+                ///         only contains prepare_frame(), the drawing is part of "tiles"
+                /// @param active 
+                /// @param dump_ms if > 0, the statistics are written to the log in this interval
+                void set_profiling(bool active, TimeMS dump_ms = 0) {
+                    profiling = active;
+                    profile_dump_ms = dump_ms;
+                    profile_last_dump = tb.get_deltatime_ms();
+                }
+
+                /// @brief  the collected timing statistics. The statistics are not reset when profiling is switched off
+                FrameProfiler& get_profiler() { return profiler; }
+
+                /// @brief  lets particle effects and transparent shapes blend directly into the frame buffer of the LightArray
+                ///         using the SIMD kernels of @link Blend.hpp @endlink instead of calling set_pixel() for every pixel
+                /// @param provider usually the LightArray itself, nullptr switches back to set_pixel()
+                void set_raw_canvas(RawCanvasProvider* provider) { raw_canvas = provider; }
+
+                /// @brief  limits the number of particles of all particle effects together (see @link ParticleBudget @endlink). Effects
+                ///         earlier in the chain are served first, each effect drops particles according to its own @link DropPolicy @endlink
+                /// @param max_particles SIZE_MAX removes the limit
+                void set_particle_budget(size_t max_particles) {
+                    particle_budget.set_max(max_particles);
+                    context.particles = (max_particles == SIZE_MAX) ? nullptr : &particle_budget;
+                }
+
+                /// @brief  the scene-wide particle budget with the number of particles claimed in the last frame
+                const ParticleBudget& get_particle_budget() { return particle_budget; }
+
+                /// @brief  seeds the random generators of all effects of the active chain, each effect gets its own stream. The same
+                ///         seed gives the same frames if the sound input and the timestamps are the same (see @link SoundRecorder @endlink).
+                ///         Effects added to the chain later are seeded as well, see @link EffectChain::seed_effects() @endlink
+                /// @param seed
+                void seed_effects(uint64_t seed) { fx_chain->seed_effects(seed); }
+
+                /// @brief  the sound input of the current frame. The effects get it with the @link RenderContext @endlink, modifiers
+                ///         reading the sound (e.g. @link ColorModifierLoudness @endlink) read the same values if it is passed to them
+                const SoundSnapshot* get_sound_snapshot() { return &snapshot; }
+
+                /// @brief  records the sound input at the start of each frame, see @link SoundRecorder @endlink
+                /// @param recorder nullptr stops recording
+                void set_sound_recorder(SoundRecorder* recorder) { this->recorder = recorder; }
+
                 LightArray* get_array() { return this->ar; }
                 TimeBase& get_timebase() { return tb; }
 
@@ -104,12 +324,19 @@ namespace prgbfx {
                 /// @param time_delta 
                 inline virtual void post_frame(TimeMS time_delta) {}
 
+                /// @brief  commits the frame to the output. Derived classes for LightArray implementations that can transfer parts of
+                ///         the frame may override this and only transfer the spans of the changed region (see @link DirtyRegion::for_each_span() @endlink).
+                ///         Not called in pipelined mode, the output thread always commits the entire buffer
+                /// @param changed the areas that differ from the last frame, nullptr if dirty tracking is not active
+                inline virtual void commit_frame(const DirtyRegion* changed) { ar->commit_buffer(); }
+
                 /// @brief  pre_effect will be called before an effect will be calculated
                 /// @param time_delta 
                 /// @param e 
                 inline virtual void pre_effect(TimeMS time_delta, Effect *e) {}
 
-                /// @brief  post_effect will be called after an effect has been calculated
+                /// @brief  post_effect will be called after an effect has been calculated. With multiple render threads the calls for
+                ///         tileable effects are made once their tiles have been drawn, still in the order of the chain
                 /// @param time_delta 
                 /// @param e 
                 inline virtual void post_effect(TimeMS time_delta, Effect *e) {}
@@ -18,8 +18,12 @@
 #include <TimeBase.hpp>
 #include <Sine.hpp>
 #include <ColorModifier.hpp>
+#include <ColorPipeline.hpp>
 #include <EffectColor.hpp>
 #include <PositionModifier.hpp>
+#include <DirtyRegion.hpp>
+#include <Span.hpp>
+#include <SpanTable.hpp>
 
 namespace prgbfx {
 
@@ -48,24 +52,37 @@ namespace prgbfx {
             virtual void draw(Point origin, Size size, TimeMS time_delta) = 0;
             /// @brief this applies the PositionModifiers and calls draw.
             /// @param time_delta 
-            void drawmod(TimeMS time_delta){
+            /// @param dirty if not nullptr, the area of the shape is added to it
+            /// @param canvas if not nullptr, transparent shapes are blended directly into this frame buffer
+            void drawmod(TimeMS time_delta, DirtyRegion* dirty = nullptr, const RawCanvas* canvas = nullptr){
                 RectArea modarea = box;
-                
-                for (auto pmod : posmods) {
-                    modarea = pmod->calc_shape(time_delta,modarea.origin,modarea.size);
-                }
+                apply_position_modifiers(posmods, time_delta, &modarea, 1);
 
+                if (dirty) dirty->add(modarea);
+                this->canvas = canvas;
                 draw(modarea.origin, modarea.size,time_delta);
+                this->canvas = nullptr;
             }
 
             /// @brief  changes the origin
             /// @param origin 
             void set_origin(Point origin) { this->box.origin = origin; }
 
+            /// @brief  changes origin and size, e.g. to draw the same shape at different places
+            /// @param box 
+            virtual void set_box(const RectArea& box) { this->box = box; }
+
             /// @brief  Set the opacity
             /// @param opacity 100 means the object has no transparence
             void set_opacity(int8_t opacity) { this->opacity = opacity; }
 
+            /// @brief  passes the sound snapshot of the frame to the position and color modifiers of the shape
+            /// @param snapshot nullptr to read the sound directly
+            void set_sound_snapshot(const SoundSnapshot* snapshot) {
+                set_sound_snapshots(posmods, snapshot);
+                set_sound_snapshots(colmods, snapshot);
+            }
+
             inline Point get_origin() { return box.origin; };
             inline Size get_size() { return box.size; };
 
@@ -77,15 +94,21 @@ namespace prgbfx {
             EffectColor* color;
             ColorMode mode_color;
             uint8_t opacity = 100;
+            const RawCanvas* canvas = nullptr;   // only set during drawmod()
 
-            ColorValue get_color(TimeMS time_delta, ColorValue color = 0) {
-                ColorValue color_new = color;
+            ColorPipeline colpipe;
+            bool colpipe_prepared = false;
+            TimeMS colpipe_time = 0;
 
-                for (auto cmod : colmods) {
-                        color_new = cmod->modify(color_new,time_delta);
+            /// @brief  the modified color, the modifiers are evaluated once per time stamp (like PositionModifier::prepare()),
+            ///         so a shape that is drawn many times in a frame asks them only once
+            ColorValue get_color(TimeMS time_delta, ColorValue color = 0) {
+                if (!colpipe_prepared || (time_delta != colpipe_time)) {
+                    colpipe.prepare(colmods, time_delta);
+                    colpipe_prepared = true;
+                    colpipe_time = time_delta;
                 }
-
-                return color_new;                
+                return colpipe.apply(color);
             }
 
     };
@@ -117,11 +140,7 @@ namespace prgbfx {
                 ColorValue color_current = color->get_color(time_delta);
                 ColorValue color_new = get_color(time_delta, color_current);
                 
-                for (uint16_t cx = 0; cx < size.w; cx++) {
-                    for (uint16_t cy = 0; cy < size.h; cy++) {
-                        ar->set_pixel(Point(cx+origin.x,cy+origin.y),color_new,mode_color,opacity);
-                    }
-                }   
+                draw_rect(ar,RectArea(origin,size),color_new,mode_color,opacity,nullptr,canvas);
             }
     };
 
@@ -158,18 +177,17 @@ namespace prgbfx {
 
                 if ((size.h < 2) || (size.w < 2) ) return;
 
-                for (int j = 0; j < std::min(width_frame,(Dimension) (size.h/2)); j++) {
-                    for (int i=0;i < size.w; i++) {
-                        ar->set_pixel(Point(origin.x+i,origin.y+j),color_new,mode_color,opacity);
-                        ar->set_pixel(Point(origin.x+i,origin.y+size.h-j-1),color_new,mode_color,opacity);
-                    }
-                }
-                for (int i=0; i< std::min(width_frame,(Dimension)(size.w/2)); i++) {
-                    for (int j=width_frame; j<size.h-width_frame; j++) {
-                        ar->set_pixel(Point(origin.x+i,origin.y+j),color_new,mode_color,opacity);
-                        ar->set_pixel(Point(origin.x+size.w-i-1,origin.y+j),color_new,mode_color,opacity);
-                    }
-                }
+                // top and bottom rows
+                Dimension rows = std::min(width_frame,(Dimension) (size.h/2));
+                draw_rect(ar,RectArea(origin,Size(size.w,rows)),color_new,mode_color,opacity,nullptr,canvas);
+                draw_rect(ar,RectArea(Point(origin.x,origin.y+size.h-rows),Size(size.w,rows)),color_new,mode_color,opacity,nullptr,canvas);
+
+                // left and right columns between them
+                Dimension cols = std::min(width_frame,(Dimension)(size.w/2));
+                Dimension height = size.h-2*width_frame;
+                if (height <= 0) return;
+                draw_rect(ar,RectArea(Point(origin.x,origin.y+width_frame),Size(cols,height)),color_new,mode_color,opacity,nullptr,canvas);
+                draw_rect(ar,RectArea(Point(origin.x+size.w-cols,origin.y+width_frame),Size(cols,height)),color_new,mode_color,opacity,nullptr,canvas);
             }
             virtual ~Frame() {LOG(" Frame: Destruct");}
 
@@ -192,39 +210,25 @@ namespace prgbfx {
                 Circle(LightArray* ar, const CircleInit ci) 
                     : Shape(ar,ci.box,ci.posmods,ci.color,ci.mode,ci.colmods,ci.opacity),center(ci.box.size.w/2-1,ci.box.size.h/2-1) { 
                     };
+
+                virtual void set_box(const RectArea& box) {
+                    Shape::set_box(box);
+                    center = Point(box.size.w/2-1,box.size.h/2-1);
+                }
                 
                 virtual void draw(Point origin, Size size, TimeMS time_delta) {
 
-                    if ((center.x == 0) || (center.y == 0)) return;
+                    // the position modifiers may shrink the circle to nothing
+                    if ((center.x == 0) || (center.y == 0) || (size.w < 1) || (size.h < 1)) return;
 
                     ColorValue color_current = color->get_color(time_delta);
                     ColorValue color_new = get_color(time_delta, color_current);
 
-                    // for (int i=0; i<= size.w; i++) {
-                    //     for(int j=0; j <= size.h; j++) {
-                    //         Dimension x = abs(center.x - i*10);
-                    //         Dimension y = abs(center.y - j*10);
-                    //         if (10*x*x/(center.x*center.x) + 10*y*y/(center.y*center.y) <= 10) {
-                    //             Point p1 = Point(origin.x+i,origin.y+j);
-                    //             ar->set_pixel(Point(p1.x,p1.y),color_new,mode_color,opacity);
-                    //         }
-                    //     }
-                    // }
-
+                    // the rows of an ellipse only depend on the size, the table is shared by all circles of this size
                     int32_t height = (int32_t)size.h/2; //+(size.h&1);
                     int32_t width = (int32_t)size.w/2; //+(size.w&1);
-
-                    int32_t hh = height*height;
-                    int32_t ww = width*width;
-                    
-                    int32_t h2w2 = height*height*width*width;
-
-                    for(int32_t y=-height; y<=height; y++) {
-                        for(int32_t x=-width; x<=width; x++) {
-                            if(x*x*hh+y*y*ww <= h2w2)
-                                ar->set_pixel(Point(origin.x+width+x,origin.y+height+y),color_new,mode_color,opacity);
-                        }
-                    }
+                    const SpanTable& spans = SpanTableCache::get_ellipse(width,height);
+                    draw_span_table(ar,Point(origin.x+width,origin.y+height),spans,color_new,mode_color,opacity,canvas);
                 }
     };
 
@@ -0,0 +1,103 @@
+/**
+ * @file SlidingRegression.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Linear regression over the last n samples, updated in constant time per sample
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_SLIDINGREGRESSION_HPP
+#define PRGB_SLIDINGREGRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace prgbfx {
+
+    /**
+     * @brief Fits a line through the last count samples, which are taken at equal distances. The samples are numbered from 0
+     *        (the oldest) to count-1 (the newest). Instead of summing up all samples for each new sample the sums are moved along
+     *        with the window: when the oldest sample drops out, every other sample moves one position towards the start.
+     *        The sums are recalculated once per window to keep rounding errors from adding up
+     */
+    class SlidingRegression {
+
+        public:
+            SlidingRegression(uint16_t count) : samples(count > 1 ? count : 2) {
+                double n = (double) samples.size();
+                sum_k = n * (n - 1) / 2;
+                sum_kk = (n - 1) * n * (2 * n - 1) / 6;
+            }
+
+            /// @brief  adds the newest sample, the oldest drops out if the window is full
+            void add(double y) {
+                size_t count = samples.size();
+                if (filled < count) {
+                    sum_ky += (double) filled * y;
+                    sum_y += y;
+                    filled++;
+                } else {
+                    double oldest = samples[head];
+                    sum_ky += (double) (count - 1) * y - (sum_y - oldest);
+                    sum_y += y - oldest;
+                }
+                samples[head] = y;
+                head = (head + 1) % count;
+                if (++added_since_sum >= count) recalculate();
+            }
+
+            /// @brief  forgets all samples
+            void reset() {
+                filled = 0;
+                head = 0;
+                sum_y = sum_ky = 0;
+                added_since_sum = 0;
+            }
+
+            /// @brief  true after count samples have been added
+            inline bool is_full() const { return filled == samples.size(); }
+
+            inline size_t get_count() const { return samples.size(); }
+
+            /// @brief  the slope of the line in units per sample, 0 until the window is full
+            double get_slope() const {
+                if (!is_full()) return 0.0;
+                double n = (double) samples.size();
+                return (n * sum_ky - sum_k * sum_y) / (n * sum_kk - sum_k * sum_k);
+            }
+
+            /// @brief  the value of the line at the oldest sample, 0 until the window is full
+            double get_offset() const {
+                if (!is_full()) return 0.0;
+                return (sum_y - get_slope() * sum_k) / (double) samples.size();
+            }
+
+        protected:
+            std::vector<double> samples;    // ring buffer, head is the oldest sample if the window is full
+            size_t head = 0;
+            size_t filled = 0;
+            size_t added_since_sum = 0;
+
+            double sum_y = 0, sum_ky = 0;   // sums over the samples in the window
+            double sum_k, sum_kk;           // sums over the positions of a full window
+
+            void recalculate() {
+                size_t count = samples.size();
+                size_t first = (filled < count) ? 0 : head;
+                sum_y = sum_ky = 0;
+                for (size_t k = 0; k < filled; k++) {
+                    double y = samples[(first + k) % count];
+                    sum_y += y;
+                    sum_ky += (double) k * y;
+                }
+                added_since_sum = 0;
+            }
+    };
+
+}
+
+#endif
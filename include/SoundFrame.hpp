@@ -0,0 +1,60 @@
+/**
+ * @file SoundFrame.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief The state of the sound input (all values provided by @link LoudnessBase @endlink) and the timestamp of one frame
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_SOUNDFRAME_HPP
+#define PRGB_SOUNDFRAME_HPP
+
+#include <LoudnessBase.hpp>
+#include <TimeBase.hpp>
+
+#include <cstdint>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /// @brief The loudness modes used by prgbfx. A SoundFrame stores one value per mode in this order
+    static const LoudnessMode sound_frame_modes[] = { LD_Realtime, LD_environment, LD_Band_Bass };
+    static const uint8_t sound_frame_mode_count = sizeof(sound_frame_modes) / sizeof(sound_frame_modes[0]);
+
+    /// @brief number of frequency bands provided by @link LoudnessBase::get_freq_band() @endlink
+    static const uint8_t sound_frame_band_count = 6;
+
+    /**
+     * @brief All values the effects query from the LoudnessBase during a frame, together with the timestamp
+     */
+    struct SoundFrame {
+        TimeMS time = 0;
+        Loudness loudness[sound_frame_mode_count] = {};
+        Loudness bands[sound_frame_band_count] = {};
+        bool silent = false;
+        bool not_silent = false;
+
+        /// @brief  reads all values from the hardware abstraction
+        void capture(LoudnessBase& lb, TimeBase& tb) {
+            time = tb.get_deltatime_ms();
+            for (uint8_t i = 0; i < sound_frame_mode_count; i++) loudness[i] = lb.get_loudness(sound_frame_modes[i]);
+            for (uint8_t i = 0; i < sound_frame_band_count; i++) bands[i] = lb.get_freq_band(i);
+            silent = lb.is_silent();
+            not_silent = lb.is_not_silent();
+        }
+
+        /// @brief  the stored value for a loudness mode
+        /// @return 0 for modes not stored in a SoundFrame
+        Loudness get_loudness(LoudnessMode mode) const {
+            for (uint8_t i = 0; i < sound_frame_mode_count; i++) if (sound_frame_modes[i] == mode) return loudness[i];
+            return 0;
+        }
+    };
+
+}
+
+#endif
@@ -14,6 +14,19 @@
 
 #include <LoudnessBase.hpp>
 #include <TimeBase.hpp>
+#include <SoundSnapshot.hpp>
+#include <SlidingRegression.hpp>
+#include <BeatTracker.hpp>
+#include <TripleBuffer.hpp>
+#include <Log.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace prgbfx {
 
@@ -21,59 +34,160 @@ namespace prgbfx {
 
     typedef uint16_t ObserverFlags;
 
+    /// @brief The results of the sound analysis which are read by the effects
+    struct SoundObserverState {
+        static const size_t max_trend_windows = 8;
+
+        ObserverFlags flags = 0;
+        int ld0_255 = 0;
+        int ld_delta = 0;
+        double trend_slope[max_trend_windows] = {};     // dB per second
+        double trend_offset[max_trend_windows] = {};
+        TimeMS time = 0;                                // time stamp of the analysis
+
+        double beat_period = 0;                         // ms per beat, 0 without a tempo
+        TimeMS next_beat = 0;                           // time stamp of the next predicted beat
+        uint32_t onsets = 0;                            // number of onsets / beats since the start, an effect can compare them
+        uint32_t beats = 0;                             // with the last frame to see the ones that happened between two latches
+    };
+
     /**
      * @brief This class will be called when displaying a frame. It collects and assesses the sound data provided
      *        by the @link LoudnessBase @endlink class (Loudness / Frequency Band information), sets flags and provides
-     *        data to help spawn the next effect or to select proper followup effects
+     *        data to help spawn the next effect or to select proper followup effects.
+     *        The analysis runs either once per frame in the render thread (collect_sound_data() called by the scene) or on its own
+     *        thread at a fixed rate (see start_async()). In the second case the results are handed over through a
+     *        @link TripleBuffer @endlink and latch() makes the newest results visible to the effects once per frame, so the values
+     *        do not change while a frame is drawn
      */
     class SoundObserver {
 
-        ObserverFlags flags=0;
-
         TimeMS nobass_timestamp = 0;
         Softener<Loudness> ld_soft = Softener<Loudness>(2000);
         Softener<Loudness> ld_norm = Softener<Loudness>(250);
         Softener<int> ld_0_255soft = Softener<int>(150);
 
-        double ld_linreq_slope = 0.0;
-        double ld_linreq_offset = 0.0;
-        int ld0_255 = 0;
-        int ld_delta = 0;
-
         public:
             const static TimeMS time_nobass_threshold = 4000; // time span to detect a fade out / build up
-            const static TimeMS time_linreg_sample = 1500;    // length of the sample to be used for build up
-            const static int16_t ld_linreg_sample_count = 10; // number of data points for linear regression
+            const static TimeMS time_linreg_sample = 1500;    // length of the default window used for build up / fade out
+            const static int16_t ld_linreg_sample_count = 10; // number of data points of the default window
             const static int32_t ld_linreg_sample_length = time_linreg_sample/ld_linreg_sample_count;
 
-            enum ObserverFlag:uint8_t { SO_Silence=0, SO_LoudnessPeak=1, SO_NoBass=2, SO_Buildup=3, SO_FadeOut=4, SO_DynamicPeak=5, SO_PeakHigh=6, SO_PeakLow=7 };
+            enum ObserverFlag:uint8_t { SO_Silence=0, SO_LoudnessPeak=1, SO_NoBass=2, SO_Buildup=3, SO_FadeOut=4, SO_DynamicPeak=5, SO_PeakHigh=6, SO_PeakLow=7, SO_Onset=8, SO_Beat=9 };
+
+            SoundObserver(LoudnessBase& lb, TimeBase& tb) : lb(lb), tb(tb) { 
+                LOG("SoundObserver: Construct");
+                // window 0 sets SO_Buildup and SO_FadeOut, the longer ones detect slow changes
+                add_trend_window(time_linreg_sample, ld_linreg_sample_count);
+                add_trend_window(8000, 16);
+                add_trend_window(30000, 30);
+            }
+
+            ~SoundObserver() {
+                LOG("SoundObserver: Destruct");
+                stop_async();
+            }
+
+            /// @brief  runs the analysis on its own thread every interval ms, independent of the frame rate. The thread captures its
+            ///         own @link SoundSnapshot @endlink, so the LoudnessBase and TimeBase have to be readable from another thread.
+            ///         Neither thread ever waits for the other one
+            /// @param interval time between two analysis steps
+            void start_async(TimeMS interval) {
+                stop_async();
+                analysis_interval = (interval > 0) ? interval : 1;
+                stopping = false;
+                sound.set_snapshot(&async_snapshot);
+                shared.back() = state;      // the getters keep the current results until the first step
+                shared.publish();
+                shared.update();
+                view = &shared.front();
+                async = true;
+                analysis = std::thread([this]() { work(); });
+            }
+
+            /// @brief  stops the analysis thread, the scene calls collect_sound_data() once per frame again
+            void stop_async() {
+                if (!async) return;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    stopping = true;
+                }
+                cv_stop.notify_one();
+                analysis.join();
+                async = false;
+                sound.set_snapshot(frame_snapshot);
+                view = &state;
+            }
+
+            inline bool is_async() const { return async; }
+
+            /// @brief  reads the sound input from the snapshot of the frame, set by the scene. The analysis thread captures its own
+            void set_sound_snapshot(const SoundSnapshot* snapshot) {
+                frame_snapshot = snapshot;
+                if (!async) sound.set_snapshot(snapshot);
+            }
+
+            /// @brief  number of analysis steps done by the analysis thread
+            uint64_t get_async_steps() const { return async_steps.load(std::memory_order_relaxed); }
+
+            /// @brief  makes the newest results of the analysis thread visible to the getters. Called by the render thread once per
+            ///         frame, does nothing if the analysis runs in the render thread
+            void latch() {
+                if (!async) return;
+                shared.update();
+                view = &shared.front();
+            }
+
+            /// @brief  tracks the development of the environment loudness over another time span. The cost per frame does not depend
+            ///         on the length of the window
+            /// @param window_ms length of the window
+            /// @param samples number of samples in the window
+            ///         Has to be called before start_async(), at most SoundObserverState::max_trend_windows windows are possible
+            /// @return the index of the window for get_trend_slope(), max_trend_windows if no window has been added (also while
+            ///         the analysis thread is running)
+            size_t add_trend_window(TimeMS window_ms, uint16_t samples) {
+                if (async || (trends.size() >= SoundObserverState::max_trend_windows)) return SoundObserverState::max_trend_windows;
+                if (samples < 2) samples = 2;
+                TimeMS sample_length = (window_ms / samples > 0) ? window_ms / samples : 1;
+                trends.push_back(TrendWindow({ sample_length, SlidingRegression(samples) }));
+                return trends.size() - 1;
+            }
+
+            size_t get_trend_count() const { return trends.size(); }
 
-            // Array to calculate linear regression of loudness development
-            LoudnessDB ld_linreg[ld_linreg_sample_count];
-            int32_t ld_linreg_idx = 0;
-            int32_t ld_linreg_ct = 0;
-            TimeMS ld_linreg_start = 0;
+            /// @brief  the change of the environment loudness in dB per second over a window, 0 until the window has been filled
+            double get_trend_slope(size_t window) const {
+                return (window < trends.size()) ? view->trend_slope[window] : 0.0;
+            }
 
-            SoundObserver(LoudnessBase& lb, TimeBase& tb) : lb(lb), tb(tb) {  }
+            /// @brief  the environment loudness in dB at the start of a window according to the regression line
+            double get_trend_offset(size_t window) const {
+                return (window < trends.size()) ? view->trend_offset[window] : 0.0;
+            }
 
             /// @brief Collects sound data to assess the current soundscape. Collected data will be used
-            ///        to select the next effect 
+            ///        to select the next effect. Does nothing while the analysis thread is running (see start_async())
             ///         \todo implement this
             /// @param time_delta 
             void collect_sound_data(TimeMS time_delta) {
+                if (!async) analyse(time_delta);
+            }
+
+        protected:
+            /// @brief  one analysis step, called by collect_sound_data() or by the analysis thread
+            void analyse(TimeMS time_delta) {
 
                     if (nobass_timestamp == 0) nobass_timestamp = tb.get_deltatime_ms();
 
-                    Loudness ld_env = lb.get_loudness(LD_environment);
-                    LoudnessDB ld_env_db =  lb.get_db_value(ld_env);
-                    Loudness ld_real = lb.get_loudness(LD_Realtime);
+                    LoudnessDB ld_env_db = sound.get_loudness_db(LD_environment);
+                    Loudness ld_real = sound.get_loudness(LD_Realtime);
 
 
                     // dynamic peak is when the current value exceeds the softenend old peak
                     if (ld_soft.value(time_delta,ld_real) == ld_soft.get_value_peak()) {
-                        set_flag(SO_DynamicPeak);
+                        write_flag(SO_DynamicPeak, true);
                     } else {
-                        clear_flag(SO_DynamicPeak);
+                        write_flag(SO_DynamicPeak, false);
                     }
 
 
@@ -81,43 +195,44 @@ namespace prgbfx {
                     Loudness ld_now = ld_norm.value(time_delta,ld_real);
 
                     // try to see dynamics
-                    double ld_delta_prenow = lb.get_db_value(ld_now) - lb.get_db_value(ld_pre);
+                    LoudnessDB ld_now_db = sound.get_db_value(ld_now);
+                    double ld_delta_prenow = ld_now_db - sound.get_db_value(ld_pre);
 
 
 
                     // try to normalize loudness to a value between 0-100
                     // expect dynamic range of +/- 10 dB
-                    double ld_delta_db = (lb.get_db_value(ld_now) - lb.get_db_value(ld_env)) + 10; // current softened real value against env value
+                    double ld_delta_db = (ld_now_db - ld_env_db) + 10; // current softened real value against env value
                     ld_delta_db = 13 * ((ld_delta_db < 0) ? 0 : (ld_delta_db > 20) ? 20 : ld_delta_db); 
 
-                 ld0_255 = ld_0_255soft.value(time_delta, static_cast<Loudness>(ld_delta_db));
-                 ld0_255 = ld0_255 * ld0_255 / 255;
+                    int ld0_255 = ld_0_255soft.value(time_delta, static_cast<Loudness>(ld_delta_db));
+                    state.ld0_255 = ld0_255 * ld0_255 / 255;
 
                     // Quite ld_env_dbironment
-                    if (lb.is_silent()) {
-                        set_flag(SO_Silence);
-                        clear_flag(SO_PeakHigh);
-                        clear_flag(SO_PeakLow);
-                    } else if (lb.is_not_silent()) {
-                        clear_flag(SO_Silence);
-                        set_flag_state(SO_PeakHigh,(ld_delta_prenow > 9.0));
-                        set_flag_state(SO_PeakLow,(ld_delta_prenow < -9.0));
-                        ld_delta = static_cast<int>(ld_delta_prenow*10.0);
+                    if (sound.is_silent()) {
+                        write_flag(SO_Silence, true);
+                        write_flag(SO_PeakHigh, false);
+                        write_flag(SO_PeakLow, false);
+                    } else if (sound.is_not_silent()) {
+                        write_flag(SO_Silence, false);
+                        write_flag(SO_PeakHigh,(ld_delta_prenow > 9.0));
+                        write_flag(SO_PeakLow,(ld_delta_prenow < -9.0));
+                        state.ld_delta = static_cast<int>(ld_delta_prenow*10.0);
 
                     }
                     
                     // \todo hysteresis: Silence -> <60dB, no Silence -> >63dB                    
-                    if (lb.get_loudness_db(LD_Realtime) >= (ld_env_db + 3.0)) {
-                        if (!is_flag_set(SO_Silence)) set_flag(SO_LoudnessPeak);
+                    if (sound.get_loudness_db(LD_Realtime) >= (ld_env_db + 3.0)) {
+                        if ((state.flags & (1 << SO_Silence)) == 0) write_flag(SO_LoudnessPeak, true);
                     } else {
-                        clear_flag(SO_LoudnessPeak);
-                        clear_flag(SO_NoBass);
+                        write_flag(SO_LoudnessPeak, false);
+                        write_flag(SO_NoBass, false);
                     }
 
                     //  detect missing bass tones
-                    if (lb.get_loudness(LD_Band_Bass) < ld_env_db) {
+                    if (sound.get_loudness(LD_Band_Bass) < ld_env_db) {
                         if ((time_delta - nobass_timestamp) > time_nobass_threshold) {
-                            flags |= (1 << SO_NoBass);
+                            write_flag(SO_NoBass, true);
                         }
                     } else {
                         nobass_timestamp = time_delta;
@@ -125,82 +240,99 @@ namespace prgbfx {
 
                     // build up? fade out? Check if the average constantly going up/down.
 
-                    if (ld_linreg_start == 0) ld_linreg_start = time_delta; // Initialize start time stamp
-
-                    // calculate index in sample array
-                    //int32_t idx = (((time_delta-ld_linreg_start) % (time_linreg_sample)) / ld_linreg_sample_length);
-                    int64_t idx = ((time_delta-ld_linreg_start)/ld_linreg_sample_length) % ld_linreg_sample_count;
-
-                    // time for a new sample?
-                    if (idx != ld_linreg_idx) {
-                        ld_linreg[idx] = ld_env_db;
-                        ld_linreg_ct++;
-
-                        // don't start before the entire time span is considered
-                        if (ld_linreg_ct >= ld_linreg_sample_count) {
-                            
-                            // Do linear regression
-                            double dsumX=0, dsumY=0,dsumX2=0, dsumXY=0;
-                            for (int16_t i=0; i< ld_linreg_sample_count; i++) {
-                                // real index: start at current point in time
-                                int32_t ri = (ld_linreg_idx+i) % ld_linreg_sample_count;
-                                // x value in ms
-                                double x = static_cast<double>(i*ld_linreg_sample_length);
-                                double y = static_cast<double>(ld_linreg[ri]);
-                                
-                                // sum up
-                                dsumX += x;
-                                dsumX2 += x*x;
-                                dsumY += y;
-                                dsumXY += x*y;
-                            }
-
-                            double dcount = static_cast<double>(ld_linreg_sample_count);
-                            
-                            ld_linreq_slope = (dcount*dsumXY - dsumX*dsumY) / (dcount*dsumX2-dsumX*dsumX);
-                            ld_linreq_offset = (dsumY - ld_linreq_slope*dsumX) / dcount;
-                        }
-                        ld_linreg_idx = idx;
-
+                    if (trend_start == 0) trend_start = time_delta; // Initialize start time stamp
+
+                    for (size_t w = 0; w < trends.size(); w++) {
+                        // time for a new sample? If frames have been missed, the missed samples get the current value
+                        TrendWindow& t = trends[w];
+                        int64_t slot = (time_delta - trend_start) / t.sample_length;
+                        if (slot == t.slot) continue;
+                        int64_t count = (t.slot < 0) ? 1 : std::min<int64_t>(slot - t.slot, t.regression.get_count());
+                        for (int64_t i = 0; i < count; i++) t.regression.add(ld_env_db);
+                        t.slot = slot;
+                        state.trend_slope[w] = 1000 * t.regression.get_slope() / t.sample_length;
+                        state.trend_offset[w] = t.regression.get_offset();
                     }
 
-                    if (get_ld_linreq_slope() > 1.0) set_flag(SO_Buildup); else clear_flag(SO_Buildup);
-                    if (get_ld_linreq_slope() < -1.0) set_flag(SO_FadeOut); else clear_flag(SO_FadeOut);
+                    write_flag(SO_Buildup, state.trend_slope[0] > 1.0);
+                    write_flag(SO_FadeOut, state.trend_slope[0] < -1.0);
+
+                    // onsets and beats from the rises in the frequency bands
+                    LoudnessDB bands_db[sound_frame_band_count];
+                    for (uint8_t b = 0; b < sound_frame_band_count; b++) bands_db[b] = sound.get_freq_band_db(b);
+                    beat_tracker.update(time_delta, bands_db, sound_frame_band_count, sound.is_silent());
+                    write_flag(SO_Onset, beat_tracker.is_onset());
+                    write_flag(SO_Beat, beat_tracker.is_beat());
+                    state.beat_period = beat_tracker.get_beat_period();
+                    state.next_beat = beat_tracker.get_next_beat();
+                    state.onsets = beat_tracker.get_onset_count();
+                    state.beats = beat_tracker.get_beat_count();
 
+                    state.time = time_delta;
 
             }
 
-            inline double get_ld_linreq_slope() { return 1000*ld_linreq_slope;}
-            inline double get_ld_linreq_offset() { return ld_linreq_offset;}
+            /// @brief  sets or clears a flag of the analysis state, only called by the analysis
+            inline void write_flag(ObserverFlag flag, bool set) {
+                if (set) state.flags |= (1 << flag); else state.flags &= ~(1 << flag);
+            }
 
-            ObserverFlags get_flags() { return flags; }
+        public:
+            /// @brief  the change of the environment loudness in dB per second over the default window (see get_trend_slope())
+            inline double get_ld_linreq_slope() { return get_trend_slope(0);}
+            inline double get_ld_linreq_offset() { return get_trend_offset(0);}
+
+            ObserverFlags get_flags() { return view->flags; }
 
-            inline bool is_flag_set(ObserverFlags flag) { return (flags & (1 << flag));}
+            inline bool is_flag_set(ObserverFlags flag) { return (view->flags & (1 << flag));}
             
-            inline void set_flag(ObserverFlag flag) {
-                flags |= (1 << flag);
-            }
+            /// @brief  sets a flag until the next analysis step updates it. Does nothing while the analysis thread is running,
+            ///         the thread owns the analysis state (see start_async())
+            inline void set_flag(ObserverFlag flag) { set_flag_state(flag, true); }
 
-            inline void clear_flag(ObserverFlag flag) {
-                flags &= ~(1 << flag);
-            }
+            /// @brief  clears a flag, see set_flag()
+            inline void clear_flag(ObserverFlag flag) { set_flag_state(flag, false); }
 
+            /// @brief  sets or clears a flag, see set_flag()
             inline void set_flag_state(ObserverFlag flag, bool set) {
-                if (set) set_flag(flag); else clear_flag(flag);
+                if (!async) write_flag(flag, set);
             }
 
             inline int16_t get_ld_0_100() {
-                return  std::min(100,(ld0_255*100)/255);
+                return  std::min(100,(view->ld0_255*100)/255);
             }
 
             inline uint8_t get_ld_0_255() {
-                return ld0_255;
+                return view->ld0_255;
             }
 
             inline int get_delta() {
-                return ld_delta;
+                return view->ld_delta;
             }
 
+            /// @brief  true if the beat tracker follows a tempo
+            inline bool has_tempo() { return view->beat_period > 0; }
+
+            /// @brief  the tempo in beats per minute, 0 without a tempo
+            inline double get_bpm() {
+                return has_tempo() ? 60000.0 / view->beat_period : 0.0;
+            }
+
+            /// @brief  time until the next predicted beat, e.g. to start a spawn ahead of the beat. Beats predicted by an older
+            ///         analysis step which have passed already are continued with the tempo
+            /// @param time_delta the current time stamp
+            /// @return 0 without a tempo
+            TimeMS get_time_to_next_beat(TimeMS time_delta) {
+                if (!has_tempo()) return 0;
+                double period = view->beat_period;
+                double next = view->next_beat;
+                if (next <= time_delta) next += period * (1 + (int64_t) ((time_delta - next) / period));
+                return (TimeMS) (next - time_delta);
+            }
+
+            /// @brief  all results of the analysis, see latch()
+            const SoundObserverState& get_state() const { return *view; }
+
         protected:
             Loudness loudness_last_avg = 0;
 
@@ -212,6 +344,55 @@ namespace prgbfx {
 
             LoudnessBase& lb;
             TimeBase& tb;
+            SoundSource sound = SoundSource(lb);   // reads the snapshot of the frame
+            const SoundSnapshot* frame_snapshot = nullptr;
+
+            /// @brief  a time span over which the development of the loudness is tracked
+            struct TrendWindow {
+                TimeMS sample_length;
+                SlidingRegression regression;
+                int64_t slot = -1;              // the time slot of the last sample
+            };
+            std::vector<TrendWindow> trends;
+            TimeMS trend_start = 0;
+
+            BeatTracker beat_tracker;
+
+            SoundObserverState state;                       // written by the analysis
+            const SoundObserverState* view = &state;        // read by the getters
+
+            // analysis thread, only used if start_async() has been called
+            bool async = false;
+            TimeMS analysis_interval = 0;
+            std::thread analysis;
+            std::mutex mtx;
+            std::condition_variable cv_stop;
+            bool stopping = false;
+            SoundSnapshot async_snapshot;
+            TripleBuffer<SoundObserverState> shared;
+            std::atomic<uint64_t> async_steps{0};
+
+            /// @brief  analysis thread: one step every analysis_interval ms. A slow step delays the next one, the missed steps are
+            ///         not caught up
+            void work() {
+                typedef std::chrono::steady_clock Clock;
+                Clock::time_point next = Clock::now();
+                std::unique_lock<std::mutex> lock(mtx);
+                while (!stopping) {
+                    lock.unlock();
+                    async_snapshot.capture(lb, tb);
+                    analyse(tb.get_deltatime_ms());
+                    shared.back() = state;
+                    shared.publish();
+                    async_steps.fetch_add(1, std::memory_order_relaxed);
+                    lock.lock();
+
+                    next += std::chrono::milliseconds(analysis_interval);
+                    Clock::time_point now = Clock::now();
+                    if (next < now) next = now;
+                    cv_stop.wait_until(lock, next, [this]() { return stopping; });
+                }
+            }
 
     };
 
@@ -0,0 +1,137 @@
+/**
+ * @file SoundRecorder.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Records the sound input of every frame into a compact binary log, which can be replayed later to reproduce a show
+ *        without audio hardware
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_SOUNDRECORDER_HPP
+#define PRGB_SOUNDRECORDER_HPP
+
+#include <SoundFrame.hpp>
+#include <Log.hpp>
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief Binary format of the sound log. All values are little endian.
+     *        Header (16 bytes): magic "PRGBSND1", uint32 seed, uint8 mode count, uint8 band count, 2 bytes reserved.
+     *        Each frame: uint32 time, uint16 loudness per mode, uint16 per band, uint8 flags (bit 0 silent, bit 1 not silent)
+     */
+    namespace soundlog {
+        static const char magic[8] = { 'P', 'R', 'G', 'B', 'S', 'N', 'D', '1' };
+        static const size_t header_size = 16;
+        static const size_t frame_size = 4 + 2 * sound_frame_mode_count + 2 * sound_frame_band_count + 1;
+
+        inline void put16(uint8_t*& p, uint16_t v) { *p++ = v & 0xff; *p++ = v >> 8; }
+        inline void put32(uint8_t*& p, uint32_t v) { put16(p, v & 0xffff); put16(p, v >> 16); }
+        inline uint16_t get16(const uint8_t*& p) { uint16_t v = p[0] | (p[1] << 8); p += 2; return v; }
+        inline uint32_t get32(const uint8_t*& p) { uint32_t v = get16(p); return v | ((uint32_t) get16(p) << 16); }
+    }
+
+    /**
+     * @brief Writes the sound input of each frame to a stream. The seed written by begin() is used to seed the effects (see
+     *        @link Scene::seed_effects() @endlink), so the spawned particles can be reproduced as well. Call record_frame() at the
+     *        start of each frame (see @link Scene::set_sound_recorder() @endlink)
+     */
+    class SoundRecorder {
+
+        public:
+            SoundRecorder(LoudnessBase& lb, TimeBase& tb) : lb(lb), tb(tb) { LOG("SoundRecorder: Construct"); }
+
+            /// @brief  writes the header
+            /// @param out stream opened in binary mode
+            /// @param seed stored in the log to seed the effects for the replay
+            void begin(std::ostream& out, uint32_t seed) {
+                this->out = &out;
+                uint8_t header[soundlog::header_size] = {};
+                memcpy(header, soundlog::magic, sizeof(soundlog::magic));
+                uint8_t* p = header + sizeof(soundlog::magic);
+                soundlog::put32(p, seed);
+                *p++ = sound_frame_mode_count;
+                *p++ = sound_frame_band_count;
+                out.write((const char*) header, sizeof(header));
+                frames = 0;
+            }
+
+            /// @brief  captures the current sound input and appends it to the log
+            /// @return the captured values
+            const SoundFrame& record_frame() {
+                current.capture(lb, tb);
+                if (out != nullptr) {
+                    uint8_t buf[soundlog::frame_size];
+                    uint8_t* p = buf;
+                    soundlog::put32(p, current.time);
+                    for (uint8_t i = 0; i < sound_frame_mode_count; i++) soundlog::put16(p, current.loudness[i]);
+                    for (uint8_t i = 0; i < sound_frame_band_count; i++) soundlog::put16(p, current.bands[i]);
+                    *p++ = (current.silent ? 1 : 0) | (current.not_silent ? 2 : 0);
+                    out->write((const char*) buf, sizeof(buf));
+                    frames++;
+                }
+                return current;
+            }
+
+            /// @brief  stops writing, the stream is not closed
+            void end() { if (out) out->flush(); out = nullptr; }
+
+            uint64_t get_frame_count() { return frames; }
+
+        protected:
+            LoudnessBase& lb;
+            TimeBase& tb;
+            std::ostream* out = nullptr;
+            SoundFrame current;
+            uint64_t frames = 0;
+    };
+
+    /**
+     * @brief A sound log loaded into memory, used to replay a recording
+     */
+    class SoundLog {
+
+        public:
+            std::vector<SoundFrame> frames;
+            uint32_t seed = 0;
+
+            /// @brief  reads a log written by @link SoundRecorder @endlink
+            /// @param in stream opened in binary mode
+            /// @return false if the stream does not contain a compatible log
+            bool read(std::istream& in) {
+                frames.clear();
+                uint8_t header[soundlog::header_size];
+                if (!in.read((char*) header, sizeof(header))) return false;
+                if (memcmp(header, soundlog::magic, sizeof(soundlog::magic)) != 0) return false;
+                const uint8_t* p = header + sizeof(soundlog::magic);
+                seed = soundlog::get32(p);
+                if ((p[0] != sound_frame_mode_count) || (p[1] != sound_frame_band_count)) return false;
+
+                uint8_t buf[soundlog::frame_size];
+                while (in.read((char*) buf, sizeof(buf))) {
+                    const uint8_t* q = buf;
+                    SoundFrame f;
+                    f.time = soundlog::get32(q);
+                    for (uint8_t i = 0; i < sound_frame_mode_count; i++) f.loudness[i] = soundlog::get16(q);
+                    for (uint8_t i = 0; i < sound_frame_band_count; i++) f.bands[i] = soundlog::get16(q);
+                    f.silent = (*q & 1) != 0;
+                    f.not_silent = (*q & 2) != 0;
+                    frames.push_back(f);
+                }
+                return true;
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file SoundSnapshot.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief The sound input of a frame, captured once by the @link Scene @endlink and read by all effects and modifiers of the frame
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_SOUNDSNAPSHOT_HPP
+#define PRGB_SOUNDSNAPSHOT_HPP
+
+#include <SoundFrame.hpp>
+#include <LoudnessBase.hpp>
+#include <TimeBase.hpp>
+
+#include <cstddef>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief A @link SoundFrame @endlink with the dB values of all loudness modes and bands. The scene captures it at the start of each
+     *        frame and hands it to the effects (see @link RenderContext @endlink), the observer and the modifiers it has been passed to,
+     *        so every @link SoundSource @endlink reading from it sees the same values during the frame and the logarithms are only
+     *        calculated once
+     */
+    struct SoundSnapshot : public SoundFrame {
+        LoudnessDB loudness_db[sound_frame_mode_count] = {};
+        LoudnessDB bands_db[sound_frame_band_count] = {};
+        bool valid = false;             // false until the first capture()
+
+        /// @brief  reads all values from the hardware abstraction and calculates the dB values
+        void capture(LoudnessBase& lb, TimeBase& tb) {
+            SoundFrame::capture(lb, tb);
+            for (uint8_t i = 0; i < sound_frame_mode_count; i++) loudness_db[i] = lb.get_db_value(loudness[i]);
+            for (uint8_t i = 0; i < sound_frame_band_count; i++) bands_db[i] = lb.get_db_value(bands[i]);
+            valid = true;
+        }
+
+        /// @brief  the position of a mode in loudness[]
+        /// @return -1 if the mode is not stored
+        static inline int mode_index(LoudnessMode mode) {
+            for (uint8_t i = 0; i < sound_frame_mode_count; i++) if (sound_frame_modes[i] == mode) return i;
+            return -1;
+        }
+    };
+
+    /**
+     * @brief Reads the sound input like a LoudnessBase, but from the snapshot of the current frame if it has been given one (see
+     *        set_snapshot()). Without a snapshot (e.g. an effect used without a scene) the values are read from the LoudnessBase
+     */
+    class SoundSource {
+
+        public:
+            SoundSource(LoudnessBase& lb) : lb(lb) {}
+
+            inline Loudness get_loudness(LoudnessMode mode) const {
+                const SoundSnapshot* s = get_snapshot();
+                int i = s ? SoundSnapshot::mode_index(mode) : -1;
+                return (i >= 0) ? s->loudness[i] : lb.get_loudness(mode);
+            }
+
+            inline LoudnessDB get_loudness_db(LoudnessMode mode) const {
+                const SoundSnapshot* s = get_snapshot();
+                int i = s ? SoundSnapshot::mode_index(mode) : -1;
+                return (i >= 0) ? s->loudness_db[i] : lb.get_loudness_db(mode);
+            }
+
+            inline Loudness get_freq_band(int band) const {
+                const SoundSnapshot* s = get_snapshot();
+                return (s && (band >= 0) && (band < sound_frame_band_count)) ? s->bands[band] : lb.get_freq_band(band);
+            }
+
+            inline LoudnessDB get_freq_band_db(int band) const {
+                const SoundSnapshot* s = get_snapshot();
+                return (s && (band >= 0) && (band < sound_frame_band_count)) ? s->bands_db[band] : lb.get_db_value(lb.get_freq_band(band));
+            }
+
+            inline bool is_silent() const {
+                const SoundSnapshot* s = get_snapshot();
+                return s ? s->silent : lb.is_silent();
+            }
+
+            inline bool is_not_silent() const {
+                const SoundSnapshot* s = get_snapshot();
+                return s ? s->not_silent : lb.is_not_silent();
+            }
+
+            /// @brief  converts any loudness value, e.g. a softened one
+            inline LoudnessDB get_db_value(Loudness value) const { return lb.get_db_value(value); }
+
+            LoudnessBase& get_loudness_base() const { return lb; }
+
+            /// @brief  reads from a snapshot, until it has been captured the values are read from the LoudnessBase
+            /// @param snapshot must be captured from the same LoudnessBase, nullptr reads from the LoudnessBase
+            void set_snapshot(const SoundSnapshot* snapshot) { this->snapshot = snapshot; }
+
+        protected:
+            LoudnessBase& lb;
+            const SoundSnapshot* snapshot = nullptr;
+
+            inline const SoundSnapshot* get_snapshot() const {
+                return (snapshot && snapshot->valid) ? snapshot : nullptr;
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file Span.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Functions to draw horizontal runs of pixels (spans) and rectangles row by row. Each span is clipped once instead of
+ *        checking every single pixel. If a @link RawCanvas @endlink is passed, the rows are filled, blended (see
+ *        @link blend_span() @endlink) or copied directly in its memory. Otherwise spans using CMODE_Set are passed to
+ *        @link LightArray::fill_rect() @endlink and all other pixels to LightArray::set_pixel()
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_SPAN_HPP
+#define PRGB_SPAN_HPP
+
+#include <LightArray.hpp>
+#include <Clip.hpp>
+#include <Blend.hpp>
+
+#include <algorithm>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /// @brief maximum number of pixels draw_row() passes on at once
+    static const Dimension span_chunk = 256;
+
+    /// @brief  clips an area against the canvas and an optional clip rectangle
+    inline RectArea clip_area(LightArray* ar, RectArea area, const RectArea* clip) {
+        area = intersect(area, ar->get_geometry().get_canvas());
+        if (clip != nullptr) area = intersect(area, *clip);
+        return area;
+    }
+
+    /// @brief  draws a rectangle of one color row by row
+    /// @param ar the array
+    /// @param area the rectangle
+    /// @param color
+    /// @param mode
+    /// @param opacity used for CMODE_Transparent
+    /// @param clip if not nullptr only the part inside clip is drawn
+    /// @param canvas if not nullptr the rows are filled or blended in this buffer
+    inline void draw_rect(LightArray* ar, RectArea area, ColorValue color, ColorMode mode = CMODE_Set, int8_t opacity = 100, const RectArea* clip = nullptr, const RawCanvas* canvas = nullptr) {
+        area = clip_area(ar, area, clip);
+        if (is_empty(area)) return;
+
+        if ((canvas != nullptr) && (area.origin.x + area.size.w <= canvas->width) && (area.origin.y + area.size.h <= canvas->height)) {
+            for (Coordinate y = area.origin.y; y < area.origin.y + area.size.h; y++) {
+                if (mode == CMODE_Set) std::fill_n(canvas->row(y) + area.origin.x, area.size.w, color);
+                else blend_span(canvas->row(y) + area.origin.x, area.size.w, color, mode, opacity);
+            }
+            return;
+        }
+        if (mode == CMODE_Set) {
+            ar->fill_rect(area, color, CMODE_Set);
+            return;
+        }
+        for (Coordinate y = area.origin.y; y < area.origin.y + area.size.h; y++) {
+            for (Coordinate x = area.origin.x; x < area.origin.x + area.size.w; x++) {
+                ar->set_pixel(Point(x, y), color, mode, opacity);
+            }
+        }
+    }
+
+    /// @brief  draws a horizontal run of pixels of one color
+    /// @param ar the array
+    /// @param x first pixel
+    /// @param y row
+    /// @param len number of pixels
+    /// @param color
+    /// @param mode
+    /// @param opacity used for CMODE_Transparent
+    /// @param clip if not nullptr only the part inside clip is drawn
+    /// @param canvas if not nullptr the span is filled or blended in this buffer
+    inline void draw_span(LightArray* ar, Coordinate x, Coordinate y, Dimension len, ColorValue color, ColorMode mode = CMODE_Set, int8_t opacity = 100, const RectArea* clip = nullptr, const RawCanvas* canvas = nullptr) {
+        draw_rect(ar, RectArea(Point(x, y), Size(len, 1)), color, mode, opacity, clip, canvas);
+    }
+
+    /// @brief  draws a horizontal run of pixels with individual colors (CMODE_Set)
+    /// @param ar the array
+    /// @param x position of colors[0]
+    /// @param y row
+    /// @param colors one color per pixel
+    /// @param len number of colors
+    /// @param clip if not nullptr only the part inside clip is drawn
+    /// @param canvas if not nullptr the colors are copied into this buffer
+    inline void draw_row(LightArray* ar, Coordinate x, Coordinate y, const ColorValue* colors, Dimension len, const RectArea* clip = nullptr, const RawCanvas* canvas = nullptr) {
+        RectArea area = clip_area(ar, RectArea(Point(x, y), Size(len, 1)), clip);
+        if (is_empty(area)) return;
+
+        const ColorValue* c = colors + (area.origin.x - x);
+        if ((canvas != nullptr) && (area.origin.x + area.size.w <= canvas->width) && (y < canvas->height)) {
+            std::copy_n(c, area.size.w, canvas->row(y) + area.origin.x);
+            return;
+        }
+        for (Coordinate px = area.origin.x; px < area.origin.x + area.size.w; px++) {
+            ar->set_pixel(Point(px, y), *c++, CMODE_Set);
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file SpanTable.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Span tables describe a symmetric shape (like an ellipse) as one horizontal span per row. The tables only depend on the
+ *        size of the shape, so they are calculated once and kept in a small cache shared by all shapes of the same size
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_SPANTABLE_HPP
+#define PRGB_SPANTABLE_HPP
+
+#include <LightArray.hpp>
+#include <Span.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief The rows of a shape which is symmetric to its vertical axis. Row y (-half_h..half_h) covers the pixels
+     *        from start(y) to -start(y) relative to the center, rows with start(y) > 0 are empty
+     */
+    struct SpanTable {
+        int32_t half_w = -1;
+        int32_t half_h = -1;
+        std::vector<int32_t> starts;
+
+        inline int32_t start(int32_t y) const { return starts[y + half_h]; }
+
+        /// @brief  calculates the rows of an ellipse with the half axes half_w and half_h
+        void build_ellipse(int32_t half_w, int32_t half_h) {
+            this->half_w = half_w;
+            this->half_h = half_h;
+            starts.resize(2 * half_h + 1);
+
+            int64_t hh = (int64_t) half_h * half_h;
+            int64_t ww = (int64_t) half_w * half_w;
+            int64_t h2w2 = hh * ww;
+
+            // from the center outwards the first pixel inside the ellipse only moves towards the center
+            int32_t x = -half_w;
+            for (int32_t y = 0; y <= half_h; y++) {
+                while ((x <= 0) && (x * x * hh + (int64_t) y * y * ww > h2w2)) x++;
+                starts[half_h + y] = x;
+                starts[half_h - y] = x;
+            }
+        }
+    };
+
+    /**
+     * @brief Keeps the span tables of the most recently used ellipse sizes. Each thread has its own cache, so shapes may be drawn
+     *        by multiple threads
+     */
+    class SpanTableCache {
+
+        public:
+            static const size_t cache_size = 16;
+
+            /// @brief  the span table of an ellipse, calculated on the first use of the size
+            /// @param half_w half width, negative values are treated as 0
+            /// @param half_h half height, negative values are treated as 0
+            static const SpanTable& get_ellipse(int32_t half_w, int32_t half_h) {
+                static thread_local SpanTableCache cache;
+                return cache.get(std::max(half_w, 0), std::max(half_h, 0));
+            }
+
+        protected:
+            SpanTable tables[cache_size];
+            size_t next = 0;                // the entry to be replaced next
+
+            const SpanTable& get(int32_t half_w, int32_t half_h) {
+                for (auto& t : tables) {
+                    if ((t.half_w == half_w) && (t.half_h == half_h)) return t;
+                }
+                SpanTable& t = tables[next];
+                next = (next + 1) % cache_size;
+                t.build_ellipse(half_w, half_h);
+                return t;
+            }
+    };
+
+    /// @brief  draws the spans of a table
+    /// @param ar the array
+    /// @param center position of row 0 and column 0 of the table
+    /// @param table
+    /// @param color
+    /// @param mode
+    /// @param opacity used for CMODE_Transparent
+    /// @param canvas if not nullptr CMODE_Transparent and CMODE_Alpha are blended into this buffer
+    inline void draw_span_table(LightArray* ar, Point center, const SpanTable& table, ColorValue color, ColorMode mode = CMODE_Set, int8_t opacity = 100, const RawCanvas* canvas = nullptr) {
+        for (int32_t y = -table.half_h; y <= table.half_h; y++) {
+            int32_t x = table.start(y);
+            if (x > 0) continue;
+            draw_span(ar, center.x + x, center.y + y, 1 - 2 * x, color, mode, opacity, nullptr, canvas);
+        }
+    }
+
+}
+
+#endif
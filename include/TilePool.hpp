@@ -0,0 +1,136 @@
+/**
+ * @file TilePool.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief A small pool of worker threads that renders a frame in tiles. The canvas is split into horizontal bands
+ *        which are handed out to the workers (and the calling thread) until all of them have been drawn.
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_TILEPOOL_HPP
+#define PRGB_TILEPOOL_HPP
+
+#include <Coordinates.hpp>
+#include <Log.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace prgbfx {
+
+    using namespace prgb;
+
+    /**
+     * @brief The TilePool splits the canvas into bands of full rows (so every tile walks the frame buffer row by row) and runs
+     *        a function for each tile on a fixed number of threads. run() blocks until all tiles are done, so the caller can
+     *        rely on the frame being complete when it returns.
+     */
+    class TilePool {
+
+        public:
+            /// @brief Starts the worker threads
+            /// @param threads total number of threads drawing tiles, including the thread calling run()
+            TilePool(unsigned threads) {
+                LOG("TilePool: Construct");
+                for (unsigned i = 1; i < threads; i++) {
+                    workers.emplace_back([this]() { work(); });
+                }
+            }
+
+            ~TilePool() {
+                LOG("TilePool: Destruct");
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    stopping = true;
+                }
+                cv_start.notify_all();
+                for (auto& t : workers) t.join();
+            }
+
+            /// @brief  splits the canvas into bands of tile_rows rows
+            /// @param canvas the complete drawing area
+            /// @param tile_rows height of a single tile
+            void split(RectArea canvas, Dimension tile_rows) {
+                tiles.clear();
+                if (tile_rows < 1) tile_rows = 1;
+                for (Coordinate y = 0; y < canvas.size.h; y += tile_rows) {
+                    Dimension h = (y + tile_rows > canvas.size.h) ? canvas.size.h - y : tile_rows;
+                    tiles.push_back(RectArea(Point(canvas.origin.x, canvas.origin.y + y), Size(canvas.size.w, h)));
+                }
+            }
+
+            /// @brief  runs func for each tile and returns after all tiles have been processed
+            /// @param func called with the clip rectangle of the tile
+            void run(const std::function<void(const RectArea&)>& func) {
+                if (workers.empty()) {
+                    for (auto& tile : tiles) func(tile);
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    job = &func;
+                    next_tile = 0;
+                    busy = workers.size();
+                    generation++;
+                }
+                cv_start.notify_all();
+
+                draw_tiles(func);
+
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_done.wait(lock, [this]() { return busy == 0; });
+                job = nullptr;
+            }
+
+            size_t get_thread_count() { return workers.size() + 1; }
+            size_t get_tile_count() { return tiles.size(); }
+
+        protected:
+            std::vector<std::thread> workers;
+            std::vector<RectArea> tiles;
+
+            std::mutex mtx;
+            std::condition_variable cv_start, cv_done;
+            const std::function<void(const RectArea&)>* job = nullptr;
+            std::atomic<size_t> next_tile { 0 };
+            size_t busy = 0;
+            uint64_t generation = 0;
+            bool stopping = false;
+
+            /// @brief takes tiles until none is left
+            void draw_tiles(const std::function<void(const RectArea&)>& func) {
+                for (size_t i = next_tile++; i < tiles.size(); i = next_tile++) {
+                    func(tiles[i]);
+                }
+            }
+
+            /// @brief worker loop: wait for a new generation, draw tiles, report back
+            void work() {
+                uint64_t seen = 0;
+                for (;;) {
+                    const std::function<void(const RectArea&)>* func;
+                    {
+                        std::unique_lock<std::mutex> lock(mtx);
+                        cv_start.wait(lock, [this, seen]() { return stopping || generation != seen; });
+                        if (stopping) return;
+                        seen = generation;
+                        func = job;
+                    }
+
+                    draw_tiles(*func);
+
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (--busy == 0) cv_done.notify_one();
+                }
+            }
+    };
+}
+
+#endif
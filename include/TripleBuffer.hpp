@@ -0,0 +1,62 @@
+/**
+ * @file TripleBuffer.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Hands values from one writer thread to one reader thread without locks. Neither side ever waits for the other
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef PRGB_TRIPLEBUFFER_HPP
+#define PRGB_TRIPLEBUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace prgbfx {
+
+    /**
+     * @brief Three slots: the writer fills the back slot, the reader reads the front slot and the third slot holds the latest
+     *        published value. publish() and update() swap their own slot with the third one, so the writer can publish as often as
+     *        it likes and the reader always gets the newest complete value. Values published between two update() calls are skipped
+     *
+     * @tparam T the value, copied by the writer into back()
+     */
+    template <typename T>
+    class TripleBuffer {
+
+        public:
+            /// @brief  writer: the slot to be filled before publish()
+            inline T& back() { return slots[back_idx]; }
+
+            /// @brief  writer: makes the back slot the latest value, the next back() is another slot
+            void publish() {
+                back_idx = middle.exchange(back_idx | fresh, std::memory_order_acq_rel) & index_mask;
+            }
+
+            /// @brief  reader: switches to the latest published value
+            /// @return false if nothing has been published since the last call, front() is unchanged
+            bool update() {
+                if ((middle.load(std::memory_order_relaxed) & fresh) == 0) return false;
+                front_idx = middle.exchange(front_idx, std::memory_order_acq_rel) & index_mask;
+                return true;
+            }
+
+            /// @brief  reader: the value of the last update()
+            inline const T& front() const { return slots[front_idx]; }
+
+        protected:
+            static const uint8_t index_mask = 3;
+            static const uint8_t fresh = 4;     // the middle slot has been published and not read yet
+
+            T slots[3] = {};
+            uint8_t back_idx = 0;               // only used by the writer
+            uint8_t front_idx = 1;              // only used by the reader
+            alignas(64) std::atomic<uint8_t> middle{2};
+    };
+
+}
+
+#endif
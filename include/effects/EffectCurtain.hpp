@@ -11,30 +11,18 @@
 #ifndef EFFECTCURTAIN_HPP
 #define EFFECTCURTAIN_HPP
 
-#include <EffectArrayAbstract.hpp>
+#include <EffectParticleAbstract.hpp>
+#include <PixelBatch.hpp>
+#include <ColorPipeline.hpp>
 
 namespace prgbfx
 {
     using namespace prgb;
 
-    class CurtainThread {
-        
-        public:
-            TimeMS time_birth;
-            TimeMS delay_y;
-            ColorValue color;
-            Point pt_current; 
-            u_int8_t trail;
-            int opacity;
-
-            CurtainThread(TimeMS time_birth, TimeMS delay_y, ColorValue color, Point pt_current, uint8_t trail=3, int opacity=100) 
-                : time_birth(time_birth), delay_y(delay_y), color(color), pt_current(pt_current), trail(trail), opacity(opacity) {
-                
-            };
+    /// @brief The fields of a thread of the curtain: it starts at the bottom and moves up with a trail of fading pixels
+    enum CurtainField { CURTAIN_Birth, CURTAIN_DelayY, CURTAIN_Color, CURTAIN_Current, CURTAIN_Trail };
 
-    };
-
-    class EffectCurtain : public EffectArrayAbstract<CurtainThread> {
+    class EffectCurtain : public EffectParticleAbstract<TimeMS, TimeMS, ColorValue, Point, uint8_t> {
 
         // Initialized
         LoudnessBase& lb;
@@ -43,6 +31,7 @@ namespace prgbfx
         RectArea& rect;
         EffectColor *color;
         ColorModifiers colmods = ColorModifiers();
+        ColorPipeline colpipe;
 
         TimeMS delay_x;
         TimeMS delay_y;
@@ -53,56 +42,75 @@ namespace prgbfx
         TimeMS time_start;
         Dimension x_last = 5555;
 
+        PixelBatch batch;
+
         public:
-            EffectCurtain(LightArray* ar, LoudnessBase &lb, SoundObserver &ob, RectArea& rect, EffectColor* color, ColorModifiers colmods={}, TimeMS delay_x=100, TimeMS delay_y=100, uint8_t trail=3) 
-                : EffectArrayAbstract(ar), lb(lb), ob(ob), rect(rect), color(color), colmods(colmods), delay_x(delay_x), delay_y(delay_y),trail(trail) { 
+            EffectCurtain(LightArray* ar, LoudnessBase &lb, SoundObserver &ob, RectArea& rect, EffectColor* color, ColorModifiers colmods={}, TimeMS delay_x=100, TimeMS delay_y=100, uint8_t trail=3, size_t capacity=1024) 
+                : EffectParticleAbstract(ar, capacity), lb(lb), ob(ob), rect(rect), color(color), colmods(colmods), delay_x(delay_x), delay_y(delay_y),trail(trail) { 
                     time_start = ar->get_timebase().get_deltatime_ms();
                 }
+
+            virtual void set_context(RenderContext* context) {
+                Effect::set_context(context);
+                set_sound_snapshots(colmods, context ? context->sound : nullptr);
+            }
         
+            virtual const char* get_type_name() { return "EffectCurtain"; }
+
             void render_effect(TimeMS time_delta) {
                 
                 if (!enabled) return;
 
                 Coordinate x = ((time_delta - time_start)/delay_x) % rect.size.w;
 
-                // manage items
-                if (x != x_last) {
-                    x_last = x;
-
-                    ColorValue color_new = color->get_color(time_delta);
+                // manage items, the live particles are claimed from the budget in every frame
+                bool spawn = (x != x_last);
+                x_last = x;
+                if (reserve_particles(spawn ? 1 : 0) > 0) {
 
-                    for (auto cmod : colmods) {
-                            color_new = cmod->modify(color_new,time_delta);
-                    }
+                    colpipe.prepare(colmods, time_delta);
+                    ColorValue color_new = colpipe.apply(color->get_color(time_delta));
 
-                    add_item(
-                        CurtainThread(
+                    TimeMS delay_thread = random.range(30,55);
+                    spawn_particle(
                             time_delta,
-                            rand()%25+30,
+                            delay_thread,
                             modA(color_new,ob.get_ld_0_255()),
                             Point(x,rect.size.h),
                             trail
-                        )
                     );
 
                 }
            
 
                  // draw 
-                 for_each([this, time_delta](CurtainThread& item){
-
-                    item.pt_current.y = rect.size.h-(time_delta-item.time_birth)/item.delay_y-1;
-                    for (int i=0; i < item.trail;i++)
+                 TimeMS* birth = particles.get<CURTAIN_Birth>();
+                 TimeMS* delay_thread = particles.get<CURTAIN_DelayY>();
+                 ColorValue* colors = particles.get<CURTAIN_Color>();
+                 Point* current = particles.get<CURTAIN_Current>();
+                 uint8_t* trails = particles.get<CURTAIN_Trail>();
+
+                 DirtyBounds drawn;
+                 batch.begin(ar, get_raw_canvas(), CMODE_Alpha);
+                 particles.for_each([&](size_t n){
+
+                    current[n].y = rect.size.h-(time_delta-birth[n])/delay_thread[n]-1;
+                    for (int i=0; i < trails[n];i++)
                     {
-                        int alpha = (A(item.color)*(item.trail-i-1))/item.trail;
+                        int alpha = (A(colors[n])*(trails[n]-i-1))/trails[n];
                         
-                        if ((item.pt_current.y+i < rect.size.h) && item.pt_current.y+i >= 0) ar->set_pixel(item.pt_current.translate(rect.origin).translate(0,i),modA(item.color,alpha),CMODE_Alpha);
+                        if ((current[n].y+i < rect.size.h) && current[n].y+i >= 0) batch.add(current[n].translate(rect.origin).translate(0,i),modA(colors[n],alpha));
                     }
-                    return (item.pt_current.y+item.trail > 0);
+                    drawn.add(current[n].x+rect.origin.x,current[n].y+rect.origin.y,1,trails[n]);
+                    return (current[n].y+trails[n] > 0);
 
                  });
+                 batch.flush();
+                 mark_dirty(drawn);
             }
 
+            virtual bool tracks_dirty() { return true; }
+
     };
     
 } // namespace prgbfx
@@ -12,30 +12,22 @@
 #ifndef EFFECDOTS_HPP
 #define EFFECDOTS_HPP
 
-#include <EffectArrayAbstract.hpp>
+#include <EffectParticleAbstract.hpp>
 
 namespace prgbfx
 {
     using namespace prgb;
 
-    class ParticleDot {
-        
-        public:
-
-            Circle circle;
-            TimeMS item_birth;
-            TimeMS item_lifetime;
-
-            bool kill = false;
-
-            ParticleDot(LightArray* ar,  CircleInit& ci, TimeMS item_birth, TimeMS item_lifetime) : circle(ar, ci), item_birth(item_birth), item_lifetime(item_lifetime) {};
-            ~ParticleDot() { }
-             ParticleDot(const ParticleDot& t) : circle(t.circle), item_birth(t.item_birth), item_lifetime(t.item_lifetime) {};
-            
-
-    };
+    /// @brief The fields of a dot: a circle that fades out during its lifetime. DOT_Shape is the index of the circle in the pool of
+    ///        the effect that is drawn at DOT_Origin with the size DOT_Size
+    enum DotField { DOT_Origin, DOT_Size, DOT_Shape, DOT_Birth, DOT_Lifetime, DOT_Opacity };
 
-    class EffectDots : public EffectArrayAbstract<ParticleDot> {
+    /**
+     * @brief Spawns circles of random sizes at random places on dynamic peaks, which fade out. The dots do not own a Circle:
+     *        the effect has one Circle for each color (sharing the same color modifiers), which is moved to each dot before it is
+     *        drawn. So spawning and drawing dots does not allocate any memory
+     */
+    class EffectDots : public EffectParticleAbstract<Point, Dimension, uint8_t, TimeMS, TimeMS, int8_t> {
 
         LoudnessBase& lb;
         SoundObserver& ob;
@@ -43,40 +35,60 @@ namespace prgbfx
         TimeMS time;
         TimeMS last_triggered = 0;
 
+        // spawning on the predicted beats, only used if set_beat_sync() has been called
+        bool beat_sync = false;
+        TimeMS beat_lead = 0;
+        TimeMS beat_triggered = 0;      // the beat the last dot has been spawned for
+
         ColorModifierStatic cm_static = ColorModifierStatic(150);
         EffectColorStatic clr_static = EffectColorStatic(RGB(255,255,255));
 
+        // the pool of circles, one for each color
+        static const uint8_t shape_count = 3;
+        Circle shapes[shape_count] = {
+            Circle(ar, CircleInit({ .box = RectArea(0,0,1,1), .posmods = {}, .color = color, .mode = CMODE_Transparent, .colmods = {&cm_static}, .opacity = 100 })),
+            Circle(ar, CircleInit({ .box = RectArea(0,0,1,1), .posmods = {}, .color = color2, .mode = CMODE_Transparent, .colmods = {&cm_static}, .opacity = 100 })),
+            Circle(ar, CircleInit({ .box = RectArea(0,0,1,1), .posmods = {}, .color = &clr_static, .mode = CMODE_Transparent, .colmods = {&cm_static}, .opacity = 100 }))
+        };
+
         public:
-            EffectDots(LightArray* ar, LoudnessBase &lb, SoundObserver &ob, EffectColor* color, EffectColor* color2) : EffectArrayAbstract(ar), lb(lb), ob(ob), color(color), color2(color2), time(ar->get_timebase().get_deltatime_ms()) { }
+            EffectDots(LightArray* ar, LoudnessBase &lb, SoundObserver &ob, EffectColor* color, EffectColor* color2, size_t capacity=256) : EffectParticleAbstract(ar, capacity), lb(lb), ob(ob), color(color), color2(color2), time(ar->get_timebase().get_deltatime_ms()) { }
         
+            virtual const char* get_type_name() { return "EffectDots"; }
+
             void render_effect(TimeMS time_delta) {
 
                 if (!enabled) return;
 
-                if (check_trigger(time_delta)) {
+                if (reserve_particles(check_trigger(time_delta) ? 1 : 0) > 0) {
 
                     Size size_canvas = ar->get_geometry().get_canvas_size();
-                    Dimension size_dot = 2*(1+rand()%4) + 1;
-
-                    int8_t cp = rand()%3;
+                    Dimension size_dot = 2*(1+random.below(4)) + 1;
 
-                    CircleInit ci = CircleInit({
-                                .box=RectArea(rand()%size_canvas.w, rand()%size_canvas.h, size_dot, size_dot),
-                                .posmods = {},
-                                .color= (cp==0) ? color : ((cp==1) ? color2 : &clr_static),
-                                .mode = CMODE_Transparent,
-                                .colmods = {&cm_static},
-                                .opacity = 100
-                            });
+                    int8_t cp = random.below(3);
 
-                    add_item(ParticleDot(ar,ci,time_delta,100+70*size_dot+rand()%500));
+                    Point origin = Point((Coordinate) random.below(size_canvas.w), (Coordinate) random.below(size_canvas.h));
+                    TimeMS lifetime = 100+70*size_dot+random.below(500);
+                    spawn_particle(origin,size_dot,cp,time_delta,lifetime,100);
                 }
 
-                 for_each([this, time_delta](ParticleDot& item){
-                        TimeMS current_lifetime = time_delta - item.item_birth;
-                        if (current_lifetime <= item.item_lifetime) { 
-                            item.circle.drawmod(time_delta);                        
-                            item.circle.set_opacity(100-100*current_lifetime/item.item_lifetime);
+                 Point* origin = particles.get<DOT_Origin>();
+                 Dimension* size = particles.get<DOT_Size>();
+                 uint8_t* shape = particles.get<DOT_Shape>();
+                 TimeMS* birth = particles.get<DOT_Birth>();
+                 TimeMS* lifetime = particles.get<DOT_Lifetime>();
+                 int8_t* opacity = particles.get<DOT_Opacity>();
+                 DirtyRegion* dirty = get_dirty_region();
+                 const RawCanvas* canvas = get_raw_canvas();
+
+                 particles.for_each([&](size_t i){
+                        TimeMS current_lifetime = time_delta - birth[i];
+                        if (current_lifetime <= lifetime[i]) { 
+                            Circle& circle = shapes[shape[i]];
+                            circle.set_box(RectArea(origin[i],Size(size[i],size[i])));
+                            circle.set_opacity(opacity[i]);
+                            circle.drawmod(time_delta, dirty, canvas);                        
+                            opacity[i] = 100-100*current_lifetime/lifetime[i]; // used in the next frame
                             return true;
                         } else {
                            return false;
@@ -84,10 +96,33 @@ namespace prgbfx
                  });
             }
 
+            virtual bool tracks_dirty() { return true; }
+
+            /// @brief  spawns a dot for each beat predicted by the @link SoundObserver @endlink instead of on dynamic peaks. Without
+            ///         a tempo the dots are still spawned on dynamic peaks
+            /// @param sync 
+            /// @param lead time before the beat the dot is spawned
+            void set_beat_sync(bool sync, TimeMS lead = 0) {
+                beat_sync = sync;
+                beat_lead = lead;
+            }
 
 
         private:
             bool check_trigger(TimeMS time_delta) {
+                if (beat_sync && ob.has_tempo()) {
+                    // the coming beat if it is within the lead time, otherwise the beat that has passed last
+                    int64_t period = (int64_t) (60000.0 / ob.get_bpm());
+                    TimeMS to_next = ob.get_time_to_next_beat(time_delta);
+                    int64_t beat = (int64_t) time_delta + to_next - ((to_next <= beat_lead) ? 0 : period);
+                    // the prediction of a beat may move a little, so only one dot per beat period
+                    if (beat - (int64_t) beat_triggered > period / 2) {
+                        beat_triggered = (TimeMS) beat;
+                        last_triggered = time_delta;
+                        return true;
+                    }
+                    return false;
+                }
                 //if ((last_triggered) == 0 || ((time_delta - last_triggered) > 250)) {
                 if (ob.is_flag_set(SoundObserver::SO_DynamicPeak) && (time_delta - last_triggered > 10)) {
                     last_triggered = time_delta;
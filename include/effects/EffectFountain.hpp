@@ -12,9 +12,10 @@
 #ifndef EffectFountain_hpp
 #define EffectFountain_hpp
 
-#include <effects/EffectArrayAbstract.hpp>
+#include <effects/EffectParticleAbstract.hpp>
+#include <PixelBatch.hpp>
 
-#include <functional>
+#include <vector>
 #include <Sine.hpp>
 
 #include <LoudnessBase.hpp>
@@ -24,21 +25,16 @@ namespace prgbfx {
     using namespace prgb;
 
     /**
-     * @brief This struct stores the information about the spawned "particles"
+     * @brief The fields of the spawned "particles", the speeds are in pixels per second
      * 
      */
-    struct FountainParticle {
-        Point position;
-        int speed_x, speed_y; // speed in pxiels per second
-        TimeMS time_spawn;
-        ColorValue color;
-    };
+    enum FountainField { FOUNTAIN_Position, FOUNTAIN_SpeedX, FOUNTAIN_SpeedY, FOUNTAIN_Spawn, FOUNTAIN_Color };
 
     /**
      * @brief An effect that simulates a "fountain" spawning "particles" which obey gravity
      *
      */
-    class EffectFountain : public EffectArrayAbstract<FountainParticle> {
+    class EffectFountain : public EffectParticleAbstract<Point, int, int, TimeMS, ColorValue> {
 
         TimeMS time_last_spawn = 0;
         SoundObserver& ob;
@@ -49,8 +45,19 @@ namespace prgbfx {
         RectArea box = ar->get_geometry().get_canvas();
         Softener<Loudness> ldsoft = Softener<Loudness>(1000);
 
+        PixelBatch batch;
+
+        // results of integrate(), one entry per particle
+        std::vector<Dimension> pos_x, pos_y;
+        std::vector<int8_t> item_opacity;
+        std::vector<uint8_t> alive;
+
         public:
-            EffectFountain(LightArray* ar, SoundObserver& ob, TimeMS time_spawn_delay, LoudnessBase &lb, EffectColor* color) : EffectArrayAbstract(ar), ob(ob), time_spawn_delay(time_spawn_delay), lb(lb), color(color) { }
+            EffectFountain(LightArray* ar, SoundObserver& ob, TimeMS time_spawn_delay, LoudnessBase &lb, EffectColor* color, size_t capacity=1024)
+                    : EffectParticleAbstract(ar, capacity), ob(ob), time_spawn_delay(time_spawn_delay), lb(lb), color(color),
+                      pos_x(capacity), pos_y(capacity), item_opacity(capacity), alive(capacity) { }
+
+            virtual const char* get_type_name() { return "EffectFountain"; }
 
             void render_effect(TimeMS time_delta) {
 
@@ -59,54 +66,88 @@ namespace prgbfx {
 
                 if (time_last_spawn == 0) time_last_spawn = delta;
 
+                bool spawn = false;
                 if (((delta-time_last_spawn) > time_spawn_delay) && enabled) {
                     // Loudness ldraw = lb.get_loudness(LD_Realtime);
                     // Loudness ldsoftval = ldsoft.value(delta,ldraw);
                     //if (lb.get_loudness_db(LD_Realtime) >= (lb.get_loudness_db(LD_environment) + 6.0)) {
                     //if (ldsoftval == ldsoft.get_value_peak()) {
-                        if (ob.is_flag_set(SoundObserver::SO_PeakHigh)) {
-                        time_last_spawn = delta;
-                        int xspeed = sine[(delta*20/1000)%90]/5;
-                        int yspeed = (int) sqrt(45*45-xspeed*xspeed);
-                        add_item(FountainParticle({
-                                    Point((xspeed > 0) ? box.size.w/8 : 7*box.size.w/8,1),
-                                    xspeed,
-                                    yspeed,
-                                    delta,
-                                    color->get_color(delta)})
-                        );
-                    }
+                    spawn = ob.is_flag_set(SoundObserver::SO_PeakHigh);
+                }
+
+                // the live particles are claimed from the budget in every frame
+                if (reserve_particles(spawn ? 1 : 0) > 0) {
+                    time_last_spawn = delta;
+                    int xspeed = sine[(delta*20/1000)%90]/5;
+                    int yspeed = (int) sqrt(45*45-xspeed*xspeed);
+                    spawn_particle(Point((xspeed > 0) ? box.size.w/8 : 7*box.size.w/8,1),
+                                xspeed,
+                                yspeed,
+                                delta,
+                                color->get_color(delta));
+                }
 
+                // now calculate each Particle: first the positions of all particles in one pass, then plot them
+                size_t n = particles.size();
+                integrate(delta, n);
+
+                ColorValue* colors = particles.get<FOUNTAIN_Color>();
+
+                DirtyBounds drawn;
+                batch.begin(ar, get_raw_canvas(), CMODE_Transparent);
+                for (size_t i = 0; i < n; i++) {
+                    if (!alive[i] || (pos_y[i] >= box.size.h)) continue;
+                    Dimension x = pos_x[i], y = pos_y[i];
+                    int8_t opacity = item_opacity[i];
+                    ColorValue faded = prgb::dim(colors[i],75);
+                    if (!batch.add_cross(Point(x,y),colors[i],faded,opacity)) {
+                        batch.add(Point(x,y),colors[i],opacity);
+                        batch.add(Point(x-1,y),faded,opacity);
+                        batch.add(Point(x+1,y),faded,opacity);
+                        if (y+1 < box.size.h) batch.add(Point(x,y+1),faded,opacity);
+                        if (y > 0) batch.add(Point(x,y-1),faded,opacity);
+                    }
+                    drawn.add(x-1,y-1,3,3);
                 }
+                batch.flush();
+                mark_dirty(drawn);
 
-                // now calculate each Particle
+                particles.for_each([this](size_t i) { return alive[i] != 0; });
+            }
 
-                const int gravity = 35;
+            virtual bool tracks_dirty() { return true; }
 
-                for_each([this,delta](FountainParticle& item){
-
-                        TimeMS delta_item = delta-item.time_spawn;
-
-                        Dimension x = item.position.x + item.speed_x*delta_item/1000;
-                        Dimension y = item.position.y + (item.speed_y-gravity*delta_item/1000)*delta_item/1000;
-                        int16_t intensity = 255-delta_item/7;
-                        int8_t opacity = (intensity > 100) ? 100 : intensity;
-                        ColorValue faded = prgb::dim(item.color,75);
-                        if ((x < 0) || (x >= box.size.w) || (y < 0) || (intensity-20 < 0)) {
-                            return false;
-                        }
-                        if ((y < box.size.h)) {
-                            ar->set_pixel(Point(x,y),item.color,CMODE_Transparent,opacity);
-                            ar->set_pixel(Point(x-1,y),faded,CMODE_Transparent,opacity);
-                            ar->set_pixel(Point(x+1,y),faded,CMODE_Transparent,opacity);
-                            if (y+1 < box.size.h) ar->set_pixel(Point(x,y+1),faded,CMODE_Transparent,opacity);
-                            if (y > 0) ar->set_pixel(Point(x,y-1),faded,CMODE_Transparent,opacity);
-                        }
-                        return true;
-                    });
+        protected:
+            /// @brief  calculates the positions of the first n particles at the time delta (since the start of the effect)
+            void integrate(TimeMS delta, size_t n) {
+                integrate_particles(n, delta, box.size.w, particles.get<FOUNTAIN_Position>(), particles.get<FOUNTAIN_SpeedX>(),
+                        particles.get<FOUNTAIN_SpeedY>(), particles.get<FOUNTAIN_Spawn>(), pos_x.data(), pos_y.data(), item_opacity.data(), alive.data());
             }
 
+            /**
+             * @brief Calculates the position, the opacity and whether the particle is still alive for n particles. All values are
+             *        integers (milliseconds and pixels) and the loop has no branches and no calls, so the compiler is able to
+             *        vectorize it (with -O3 or -ftree-vectorize). The arrays must not overlap
+             */
+            static void integrate_particles(size_t n, TimeMS delta, Dimension width,
+                    const Point* __restrict position, const int* __restrict speed_x, const int* __restrict speed_y, const TimeMS* __restrict time_spawn,
+                    Dimension* __restrict x_out, Dimension* __restrict y_out, int8_t* __restrict opacity_out, uint8_t* __restrict alive_out) {
+                const int gravity = 35;
+
+                for (size_t i = 0; i < n; i++) {
+                    TimeMS delta_item = delta-time_spawn[i];
+
+                    // the arithmetic is unsigned like in the former per-particle code, which keeps the same trajectories
+                    Dimension x = (Dimension) (position[i].x + speed_x[i]*delta_item/1000);
+                    Dimension y = (Dimension) (position[i].y + (speed_y[i]-gravity*delta_item/1000)*delta_item/1000);
+                    int16_t intensity = (int16_t) (255-delta_item/7);
 
+                    x_out[i] = x;
+                    y_out[i] = y;
+                    opacity_out[i] = (int8_t) ((intensity > 100) ? 100 : intensity);
+                    alive_out[i] = (x >= 0) & (x < width) & (y >= 0) & (intensity >= 20);
+                }
+            }
     };
 };
 #endif
\ No newline at end of file
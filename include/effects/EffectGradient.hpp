@@ -17,6 +17,12 @@
 #include <Color.hpp>
 #include <Coordinates.hpp>
 #include <Log.hpp>
+#include <Clip.hpp>
+#include <Span.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
 
 namespace prgbfx {
 
@@ -26,7 +32,8 @@ namespace prgbfx {
     /**
      * @brief An effect which creates a gradient color related to one point: The higher the distance from this point is the
      *        closer the color is to the secondary color. This point can be moved using a @link PositionModifier @endlink. This creates
-     *        some movement. Because this effect does calculations for each individual pixel, it's very computing intense.
+     *        some movement. The distance of each pixel to this point is kept in a distance field, each frame only calculates a
+     *        color ramp, so drawing a pixel is a table lookup.
      */
     class EffectGradient : public Effect {
     
@@ -39,28 +46,55 @@ namespace prgbfx {
                     dist_max = sqrt(width*width+height*height);
                 }
 
+            virtual void set_context(RenderContext* context) {
+                Effect::set_context(context);
+                set_sound_snapshots(posmods, context ? context->sound : nullptr);
+            }
+
+            virtual const char* get_type_name() { return "EffectGradient"; }
+
             virtual void render_effect(TimeMS time_delta) {
-                
-                RectArea rect = RectArea(pt_center, Size(1,1));
+                prepare_frame(time_delta);
+                render_tile(time_delta, box);
+            }
+
+            virtual bool is_tileable() { return true; }
+
+            /// @brief  moves the center and determines the colors of the frame
+            virtual void prepare_frame(TimeMS time_delta) {
+                rect = RectArea(pt_center, Size(1,1));
                 for (auto pos:posmods) {
                     rect = pos->calc_shape(time_delta,Point(rect.origin),Size(1,1));
                 }
 
-                ColorValue color_current = color->get_color(time_delta);
-                ColorValue color_next = color->get_color(time_delta,2);
+                color_current = color->get_color(time_delta);
+                color_next = color->get_color(time_delta,2);
+
                 if (!enabled) return;
+                update_field();
+                update_ramp();
+                mark_dirty(box);
+            }
 
-                // Loop through all pixels
-                for (int x=0; x < box.size.w; x++){
-                    for (int y=0; y < box.size.h; y++) {
+            virtual bool tracks_dirty() { return true; }
 
-                        Dimension xdist = (rect.origin.x-x) << 7;
-                        Dimension ydist = (rect.origin.y-y) << 7;
+            /// @brief  draws the pixels of the box which are inside the clip rectangle
+            virtual void render_tile(TimeMS time_delta, const RectArea& clip) {
+                if (!enabled) return;
 
-                        Dimension dist = sqrt(xdist*xdist+ydist*ydist);
-                        ColorValue color_new = prgb::dim(prgb::gradient(color_current,color_next,dist,dist_max),brightness);
+                RectArea area = intersect(box, clip);
+                ColorValue row[span_chunk];
+                const ColorValue* colors = ramp.data();
+                const RawCanvas* canvas = get_raw_canvas();
 
-                        ar->set_pixel(Point(box.origin.x+x, box.origin.y+y), color_new, CMODE_Set);
+                // Loop through all rows, each row is written in chunks
+                for (int y=area.origin.y-box.origin.y; y < area.origin.y-box.origin.y+area.size.h; y++) {
+                    const uint32_t* field_row = &field[(size_t) abs(rect.origin.y-y) * field_w];
+                    for (int x0=area.origin.x-box.origin.x; x0 < area.origin.x-box.origin.x+area.size.w; x0 += span_chunk) {
+                        int len = std::min<int>(span_chunk, area.origin.x-box.origin.x+area.size.w-x0);
+
+                        for (int i=0; i < len; i++) row[i] = colors[field_row[abs(rect.origin.x-x0-i)]];
+                        draw_row(ar, box.origin.x+x0, box.origin.y+y, row, len, nullptr, canvas);
                     }
                 }
 
@@ -74,6 +108,58 @@ namespace prgbfx {
             uint8_t brightness;
             Dimension dist_max;
 
+            // state of the current frame, set by prepare_frame()
+            RectArea rect;
+            ColorValue color_current = 0, color_next = 0;
+
+            // field[dy*field_w+dx] is the index into the ramp for a pixel dx/dy pixels away from the center. Only the
+            // distances are stored, so the field does not change when the center moves (as long as it covers the box)
+            std::vector<uint32_t> field;
+            Dimension field_w = 0, field_h = 0;
+
+            // ramp[i] is the color of all pixels at the distance ramp_dist[i] in the current frame. There are much less
+            // different distances than pixels and the colors are exactly the same as calculating each pixel
+            std::vector<Dimension> ramp_dist;
+            std::vector<ColorValue> ramp;
+            ColorValue ramp_current = 0, ramp_next = 0;
+
+            /// @brief  makes sure the field covers the distances of all pixels of the box to the current center
+            void update_field() {
+                Dimension w = std::max(abs(rect.origin.x), abs(rect.origin.x-box.size.w+1)) + 1;
+                Dimension h = std::max(abs(rect.origin.y), abs(rect.origin.y-box.size.h+1)) + 1;
+                if ((w <= field_w) && (h <= field_h)) return;
+
+                field_w = std::max(w, field_w);
+                field_h = std::max(h, field_h);
+                field.resize((size_t) field_w * field_h);
+                ramp_dist.clear();
+                for (Dimension dy = 0; dy < field_h; dy++) {
+                    for (Dimension dx = 0; dx < field_w; dx++) {
+                        Dimension xdist = dx << 7;
+                        Dimension ydist = dy << 7;
+                        Dimension dist = sqrt(xdist*xdist+ydist*ydist);
+                        field[(size_t) dy*field_w+dx] = dist;       // the distance for now, replaced by the index below
+                        ramp_dist.push_back(dist);
+                    }
+                }
+                std::sort(ramp_dist.begin(), ramp_dist.end());
+                ramp_dist.erase(std::unique(ramp_dist.begin(), ramp_dist.end()), ramp_dist.end());
+                for (auto& f : field) f = std::lower_bound(ramp_dist.begin(), ramp_dist.end(), (Dimension) f) - ramp_dist.begin();
+
+                ramp.resize(ramp_dist.size());
+                ramp_current = ~color_current; // forces a new ramp
+            }
+
+            /// @brief  calculates the colors of the ramp, only if the colors have changed
+            void update_ramp() {
+                if ((ramp_current == color_current) && (ramp_next == color_next)) return;
+                ramp_current = color_current;
+                ramp_next = color_next;
+                for (size_t i = 0; i < ramp.size(); i++) {
+                    ramp[i] = prgb::dim(prgb::gradient(color_current,color_next,ramp_dist[i],dist_max),brightness);
+                }
+            }
+
     };
 }
 
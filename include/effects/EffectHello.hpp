@@ -31,17 +31,22 @@ namespace prgbfx {
 
             EffectHello(LightArray* ar) : Effect(ar) { }
 
+            virtual const char* get_type_name() { return "EffectHello"; }
+
             /**
              * @brief render a simple effect
              * 
              * @param delta_time the time expired since reset
              */
             virtual void render_effect(TimeMS delta_time) {
-                if (!enabled) return true;
+                if (!enabled) return;
                 int8_t c = 64*((delta_time/1000) % 2);
                 ar->fill_rect(canvas,RGB(c,c,c),CMODE_Set);
+                mark_dirty(canvas);
             };
 
+            virtual bool tracks_dirty() { return true; }
+
     };
 }
 
@@ -14,6 +14,12 @@
 
 #include <Effect.hpp>
 #include <Log.hpp>
+#include <Clip.hpp>
+#include <Span.hpp>
+#include <ColorPipeline.hpp>
+#include <SoundSnapshot.hpp>
+
+#include <vector>
 
 namespace prgbfx
 {
@@ -27,59 +33,81 @@ namespace prgbfx
                 : Effect(ar), lb(lb), ldmode(ldmode), box(box), direction(direction), delay_ms(delay_ms), color(color), color_bg(color_bg),colmods(colmods), colbgmods(colbgmods) {
                 LOG(" EffectLoudnessLines: Construct");
                 Dimension extent = get_extent();
-                linecolors.reserve(extent);
+                linecolors.resize(extent);
+                if ((direction == DIR_Left) || (direction == DIR_Right)) scroll.resize(2*extent);
+                colbgpipe.prepare(colbgmods, 0);
                 for (int i=0; i < extent; i++) {
-                    linecolors[i] = color_bg->get_color(0,0);
-                    for (auto cmod : colbgmods) { 
-                        linecolors[i] = cmod->modify(linecolors[i],0);
-                    }
-
+                    set_line(i, colbgpipe.apply(color_bg->get_color(0,0)));
                 }
             };
 
             virtual ~EffectLoudnessLines() {LOG(" EffectLoudnessLines: Destruct");}
+
+            virtual const char* get_type_name() { return "EffectLoudnessLines"; }
+
+            virtual void set_context(RenderContext* context) {
+                Effect::set_context(context);
+                sound.set_snapshot(context ? context->sound : nullptr);
+                set_sound_snapshots(colmods, context ? context->sound : nullptr);
+                set_sound_snapshots(colbgmods, context ? context->sound : nullptr);
+            }
             
             virtual void render_effect(TimeMS time_delta) {
+                prepare_frame(time_delta);
+                render_tile(time_delta, box);
+            }
+
+            virtual bool is_tileable() { return true; }
+
+            /// @brief  calculates the color of the newest line
+            virtual void prepare_frame(TimeMS time_delta) {
                 if (!enabled) return;
                 Dimension extent = get_extent();
-                Loudness ld_now = lb.get_loudness(LD_Band_Bass);
+                if (extent <= 0) return;
+                Loudness ld_now = sound.get_loudness(LD_Band_Bass);
                 int16_t fadeval = (100*ld_now) / softfade.value(time_delta,ld_now) ;
                 fadeval = fadeval * fadeval / 100;
 
                 TimeMS position = time_delta % (delay_ms*extent); // cut to time window required to fill all lines
 
-                int16_t idx = position / delay_ms;
+                idx = position / delay_ms;
 
-                ColorValue color_bgnew = color_bg->get_color(time_delta);
-                for (auto cmod : colbgmods) { 
-                    color_bgnew = cmod->modify(color_bgnew,time_delta);
-                }
-                ColorValue color_new = prgb::gradient(color_bgnew,color->get_color(time_delta),(fadeval > 30) ? 30 : fadeval,30);
-                for (auto cmod : colmods) { 
-                    color_new = cmod->modify(color_new,time_delta); 
-                }
+                colbgpipe.prepare(colbgmods, time_delta);
+                colpipe.prepare(colmods, time_delta);
+                ColorValue color_bgnew = colbgpipe.apply(color_bg->get_color(time_delta));
+                ColorValue color_new = colpipe.apply(prgb::gradient(color_bgnew,color->get_color(time_delta),(fadeval > 30) ? 30 : fadeval,30));
+
+                set_line(idx, color_new);
 
-                linecolors[idx] = color_new;
-
-                for (int i =0; i < get_extent(); i++) {
-                    
-                    for (int j=0; j<getLineLength(); j++) {
-                        switch(direction) {
-                            case DIR_Right:
-                                ar->set_pixel(Point(box.origin.x+i,box.origin.y+j),linecolors[(idx-i+extent)%extent],CMODE_Set);
-                                break;
-                            case DIR_Left:
-                                ar->set_pixel(Point(box.origin.x+box.size.w-i-1,box.origin.y+j),linecolors[(idx-i+extent)%extent],CMODE_Set);
-                                break;
-                            case DIR_Down:
-                                ar->set_pixel(Point(box.origin.x+j,box.origin.y+i),linecolors[(idx-i+extent)%extent],CMODE_Set);
-                                break;
-                            case DIR_Up:
-                                ar->set_pixel(Point(box.origin.x+j,box.origin.y+box.size.h-i-1),linecolors[(idx-i+extent)%extent],CMODE_Set);
-                                break;
-                            
-                        }
-                        
+                mark_dirty(box);
+            }
+
+            virtual bool tracks_dirty() { return true; }
+
+            /// @brief  draws the lines inside the clip rectangle
+            virtual void render_tile(TimeMS time_delta, const RectArea& clip) {
+                if (!enabled) return;
+                Dimension extent = get_extent();
+                RectArea area = intersect(box, clip);
+                const RawCanvas* canvas = get_raw_canvas();
+
+                if ((direction == DIR_Down) || (direction == DIR_Up)) {
+                    // every row is a line
+                    for (int y = area.origin.y; y < area.origin.y+area.size.h; y++) {
+                        int i = (direction == DIR_Down) ? y-box.origin.y : box.origin.y+box.size.h-y-1;
+                        draw_span(ar,area.origin.x,y,area.size.w,linecolors[(idx-i+extent)%extent],CMODE_Set,100,nullptr,canvas);
+                    }
+                } else if ((canvas != nullptr) && !scroll.empty()) {
+                    // every column is a line, so all rows are the same: copy the visible window of the scroll surface into each row
+                    const ColorValue* line = &scroll[(direction == DIR_Right) ? (extent-idx)%extent : (idx+1)%extent] + (area.origin.x-box.origin.x);
+                    for (int y = area.origin.y; y < area.origin.y+area.size.h; y++) {
+                        draw_row(ar,area.origin.x,y,line,area.size.w,nullptr,canvas);
+                    }
+                } else {
+                    // every column is a line
+                    for (int x = area.origin.x; x < area.origin.x+area.size.w; x++) {
+                        int i = (direction == DIR_Right) ? x-box.origin.x : box.origin.x+box.size.w-x-1;
+                        draw_rect(ar,RectArea(Point(x,area.origin.y),Size(1,area.size.h)),linecolors[(idx-i+extent)%extent],CMODE_Set,100,nullptr,canvas);
                     }
                 }
             }
@@ -89,17 +117,35 @@ namespace prgbfx
         
         protected:
             LoudnessBase& lb;
+            SoundSource sound = SoundSource(lb);
             LoudnessMode ldmode;
             RectArea& box;
             Direction direction;
             TimeMS delay_ms;
-            ColorPalette linecolors;
+            ColorPalette linecolors;           // ring of line colors, the newest line is at idx
+            std::vector<ColorValue> scroll;     // DIR_Left/DIR_Right: the ring twice in the order of the columns, see set_line()
             EffectColor* color; 
             EffectColor* color_bg;
             const ColorModifiers colmods;
             const ColorModifiers colbgmods;
+            ColorPipeline colpipe, colbgpipe;
 
             Softener<uint16_t> softfade = Softener<uint16_t>(1000);
+
+            // index of the newest line, set by prepare_frame()
+            int16_t idx = 0;
+
+            /// @brief  sets the color of line i of the ring. For DIR_Left/DIR_Right it is also written to the two positions of the
+            ///         scroll surface, so a row of the box is always a contiguous window of the surface, starting at
+            ///         (extent-idx)%extent for DIR_Right (the ring reversed) or (idx+1)%extent for DIR_Left
+            void set_line(int16_t i, ColorValue color_line) {
+                Dimension extent = get_extent();
+                linecolors[i] = color_line;
+                if (scroll.empty()) return;
+                int pos = (direction == DIR_Right) ? (extent-i)%extent : i;
+                scroll[pos] = color_line;
+                scroll[pos+extent] = color_line;
+            }
     };
 }
 #endif
\ No newline at end of file
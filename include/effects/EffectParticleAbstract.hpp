@@ -0,0 +1,119 @@
+/**
+ * @file EffectParticleAbstract.hpp
+ * @author Holger Willenborg (holger@willenb.org)
+ * @brief Base class for effects drawing many small items (particles) that are stored in a @link ParticleArray @endlink
+ * @version 0.6
+ * @date 2024-03-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef EffectParticleAbstract_hpp
+#define EffectParticleAbstract_hpp
+
+#include <Effect.hpp>
+#include <ParticleArray.hpp>
+#include <ParticleBudget.hpp>
+
+#include <algorithm>
+
+namespace prgbfx {
+    using namespace prgb;
+
+    /**
+     * @brief Like @link EffectArrayAbstract @endlink, but the particles are stored in contiguous arrays with a fixed capacity
+     *        instead of a std::list. Particles that do not fit are not added. The fields are accessed by index, iterating
+     *        with particles.for_each() removes the particles that are not used anymore. The number of particles may be limited
+ *        further by a budget, see reserve_particles()
+     *
+     * @tparam Fields types of the fields of a particle
+     */
+    template <typename... Fields>
+    class EffectParticleAbstract : public Effect {
+
+        public:
+            EffectParticleAbstract(LightArray* ar, size_t capacity) : Effect(ar), particles(capacity), budget(capacity) { LOG(" EffectParticleAbstract: Construct"); }
+            virtual ~EffectParticleAbstract() { LOG(" EffectParticleAbstract: Destruct"); }
+
+            /// @brief  number of live particles
+            size_t get_particle_count() const { return particles.size(); }
+
+            /// @brief  maximum number of live particles
+            size_t get_particle_capacity() const { return particles.get_capacity(); }
+
+            /// @brief  limits the number of live particles of this effect. The particle effects call reserve_particles() before
+            ///         spawning, so the budget and the scene-wide budget apply to all of them
+            /// @param max_particles at most the capacity
+            /// @param policy what to drop if the budget is exceeded
+            void set_particle_budget(size_t max_particles, DropPolicy policy = DROP_New) {
+                budget = std::min(max_particles, particles.get_capacity());
+                drop_policy = policy;
+            }
+
+            size_t get_particle_budget() const { return budget; }
+            DropPolicy get_drop_policy() const { return drop_policy; }
+
+            /// @brief  particles spawned and dropped since the start, live particles after the last frame
+            const ParticleStats& get_particle_stats() {
+                stats.live = particles.size();
+                return stats;
+            }
+
+        protected:
+            ParticleArray<Fields...> particles;
+            size_t budget;
+            DropPolicy drop_policy = DROP_New;
+            ParticleStats stats;
+
+            /**
+             * @brief Applies the budget of the effect and the budget of the scene (see @link ParticleBudget @endlink). Has to be
+             *        called once per frame before spawning, also if there is nothing to spawn, so the live particles are claimed
+             *        from the scene budget. Depending on the drop policy old particles are removed to make room
+             *
+             * @param requested number of particles the effect wants to spawn in this frame
+             * @return the number of particles that may be spawned
+             */
+            size_t reserve_particles(size_t requested) {
+                size_t live = particles.size();
+                size_t limit = std::min(budget, live + requested);
+                if (context && context->particles) limit = context->particles->claim(limit);
+
+                size_t allowed;
+                if (drop_policy == DROP_New) {
+                    allowed = (limit > live) ? std::min(requested, limit - live) : 0;
+                } else {
+                    allowed = std::min(requested, limit);
+                    size_t excess = (live + allowed > limit) ? live + allowed - limit : 0;
+                    if (excess > 0) drop_particles(excess);
+                }
+                stats.dropped += requested - allowed;
+                return allowed;
+            }
+
+            /// @brief  adds a particle and counts it as spawned, or as dropped if the array is full
+            inline bool spawn_particle(Fields... values) {
+                bool added = particles.add(std::move(values)...);
+                if (added) stats.spawned++; else stats.dropped++;
+                return added;
+            }
+
+            /// @brief  removes n live particles according to the drop policy
+            void drop_particles(size_t n) {
+                stats.dropped += n;
+                if (drop_policy == DROP_ThinOut) {
+                    // removes every (live/n)th particle, spread evenly over all ages
+                    size_t live = particles.size(), acc = 0;
+                    particles.for_each([&](size_t) {
+                        acc += n;
+                        if (acc < live) return true;
+                        acc -= live;
+                        return false;
+                    });
+                } else {
+                    particles.remove_front(n);
+                }
+            }
+    };
+};
+#endif
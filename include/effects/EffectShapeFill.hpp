@@ -29,9 +29,18 @@ namespace prgbfx {
             EffectShapeFill(LightArray* ar, Shape& shape) 
                 : Effect(ar), shape(shape)  { LOG(" EffectShapeFill: Construct"); }
             virtual ~EffectShapeFill() { LOG (" EffectShapeFill: Destruct");}
+
+            virtual const char* get_type_name() { return "EffectShapeFill"; }
+
+            virtual void set_context(RenderContext* context) {
+                Effect::set_context(context);
+                shape.set_sound_snapshot(context ? context->sound : nullptr);
+            }
             virtual void render_effect(TimeMS time_delta) { 
-                if (enabled) shape.drawmod(time_delta); 
+                if (enabled) shape.drawmod(time_delta, get_dirty_region()); 
             };
+
+            virtual bool tracks_dirty() { return true; }
             
     };
 }
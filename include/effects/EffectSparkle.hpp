@@ -12,9 +12,12 @@
 #define EffectSparkle_hpp
 
 #include <Effect.hpp>
-#include <effects/EffectArrayAbstract.hpp>
+#include <effects/EffectParticleAbstract.hpp>
+#include <PixelBatch.hpp>
+#include <ColorPipeline.hpp>
 #include <LoudnessBase.hpp>
 #include <TimeBase.hpp>
+#include <algorithm>
 #include <vector>
 #include <Log.hpp>
 
@@ -23,22 +26,16 @@ namespace prgbfx {
     using namespace prgb;
 
     /**
-     * @brief This is used in conjunction with @link Effect @endlink and contains information about
-     *        a single pixel that appears and then fades away over a delay time
+     * @brief The fields of a spark, a single pixel that appears and then fades away over a delay time
      */
-    struct Spark {
-        Point origin;
-        TimeMS time_start;
-        TimeMS delay;
-        ColorValue color;
-    };
+    enum SparkField { SPARK_Origin, SPARK_Start, SPARK_Delay, SPARK_Color };
 
     /**
      * @brief Implements a sparkle effect that adds Sparks over time with slightly randomized "burn" times
      *        The sparks disapper after a while (getting transparent)
      * 
      */
-    class EffectSparkle : public EffectArrayAbstract<Spark> {
+    class EffectSparkle : public EffectParticleAbstract<Point, TimeMS, TimeMS, ColorValue> {
 
         LoudnessBase& lb;
         RectArea box;
@@ -46,6 +43,7 @@ namespace prgbfx {
 
         EffectColor* color;
         ColorModifiers colmods;
+        ColorPipeline colpipe;
 
         Softener<Loudness> peak = Softener<Loudness>(1000);
 
@@ -55,11 +53,13 @@ namespace prgbfx {
 
         bool hibernate = false;
 
+        PixelBatch batch;
+
         public:
 
 
-            EffectSparkle(LightArray* ar, LoudnessBase& lb, const RectArea& box, uint16_t density, EffectColor* color, ColorModifiers colmods, TimeMS min_spark_duration=20, TimeMS max_spark_duration=180) 
-                    : EffectArrayAbstract(ar), lb(lb), box(box), density(density), color(color), colmods(colmods),min_spark_duration(min_spark_duration), max_spark_duration(max_spark_duration) { 
+            EffectSparkle(LightArray* ar, LoudnessBase& lb, const RectArea& box, uint16_t density, EffectColor* color, ColorModifiers colmods, TimeMS min_spark_duration=20, TimeMS max_spark_duration=180, size_t capacity=4096) 
+                    : EffectParticleAbstract(ar, capacity), lb(lb), box(box), density(density), color(color), colmods(colmods),min_spark_duration(min_spark_duration), max_spark_duration(max_spark_duration) { 
                 avg_spark_duration = min_spark_duration + (max_spark_duration-min_spark_duration)/2;
                 //delay_sparkles1000 = (int32_t)(((int64_t)1000*1000*avg_spark_duration) / (int64_t) (box.size.h*box.size.w*density));
                 //delay_sparkles = delay_sparkles1000 / 1000;
@@ -69,8 +69,17 @@ namespace prgbfx {
 
             virtual ~EffectSparkle() {LOG("  EffectSparkle: Destruct");}
 
+            virtual const char* get_type_name() { return "EffectSparkle"; }
+
+            virtual void set_context(RenderContext* context) {
+                Effect::set_context(context);
+                set_sound_snapshots(colmods, context ? context->sound : nullptr);
+            }
+
+            /// @brief  sets the number of sparks per 1000 pixels that are visible at the same time (on average), 0 stops adding sparks
             void set_density(uint16_t density) { 
-                delay_sparkles1000 = (int32_t)(((int64_t)1000*1000*avg_spark_duration) / (int64_t) (box.size.h*box.size.w*density));
+                int64_t pixels = (int64_t) box.size.h*box.size.w*density;
+                delay_sparkles1000 = (pixels > 0) ? (TimeMS) std::max<int64_t>(1, ((int64_t)1000*1000*avg_spark_duration) / pixels) : 0;
                 delay_sparkles = delay_sparkles1000 / 1000;
             }
 
@@ -81,60 +90,75 @@ namespace prgbfx {
                 if (last_sparkle == 0) last_sparkle = time_delta; // initial call -> set some time
 
                 // Add sparkles after a certain time (if not disabled)
-                if ((time_delta > last_sparkle+delay_sparkles) && enabled) {
-
-                    int32_t num_sparks = (int32_t)(1000*(int32_t)(time_delta - last_sparkle) / (int32_t) delay_sparkles1000);
+                size_t num_sparks = 0;
+                if ((time_delta > last_sparkle+delay_sparkles) && enabled && (delay_sparkles1000 > 0)) {
+                    // after a stall only the sparks of the last max_spark_duration would still be visible, so a long pause
+                    // or a clock jump does not cause a burst of sparks
+                    TimeMS elapsed = std::min(time_delta - last_sparkle, max_spark_duration);
+                    num_sparks = (size_t) (((int64_t) 1000*elapsed) / delay_sparkles1000);
                     if (num_sparks > 0) LOG("  EffectSparkle: Adding effects -> "+std::to_string(num_sparks));
+                    last_sparkle = time_delta;
+                }
 
-//                    for (int32_t i = 0; i < std::min(num_sparks,(int32_t) 100) ; i++) { // #desperate attempt to fix a crash
-                    for (int32_t i = 0; i < num_sparks ; i++) { 
-                        ColorValue color_new = color->get_color(time_delta);
-
-                        for (auto cmod : colmods) {
-                                color_new = cmod->modify(color_new,time_delta);
-                        }
-
-                        add_item     (Spark(
-                                        {   
-                                            Point(rand()%box.size.w,rand()%box.size.h),
-                                            time_delta,
-                                            min_spark_duration+rand()%(max_spark_duration-min_spark_duration),
-                                            color_new
-                                        }
-                                    ));
+                size_t allowed = reserve_particles(num_sparks);
+                TimeMS spread = (max_spark_duration > min_spark_duration) ? max_spark_duration-min_spark_duration : 1;
+
+                // all sparks of a frame get the same color
+                ColorValue color_new = 0;
+                if (allowed > 0) {
+                    colpipe.prepare(colmods, time_delta);
+                    color_new = colpipe.apply(color->get_color(time_delta));
+                }
+
+                // the random numbers are generated in blocks
+                const size_t block = 64;
+                uint32_t rnd_x[block], rnd_y[block], rnd_delay[block];
+                for (size_t done = 0; done < allowed; done += block) {
+                    size_t n = std::min(block, allowed - done);
+                    random.fill_below(rnd_x, n, box.size.w);
+                    random.fill_below(rnd_y, n, box.size.h);
+                    random.fill_below(rnd_delay, n, spread);
+
+                    for (size_t i = 0; i < n; i++) {
+                        spawn_particle(Point((Coordinate) rnd_x[i],(Coordinate) rnd_y[i]), time_delta, min_spark_duration+rnd_delay[i], color_new);
                     }
-                    last_sparkle = time_delta;
                 }
 
                 hibernate = !enabled;
 
-
-                // for (auto cmod : colmods) {
-                //         color_new = cmod->modify(color_new,time_delta);
-                // }
-                LOG("  EffectSparkle: Start output: Size -> "+std::to_string(items.size()));
+                LOG("  EffectSparkle: Start output: Size -> "+std::to_string(particles.size()));
                 
-                for_each([this, time_delta](Spark& spark){
-                    if (time_delta-spark.time_start >= spark.delay) {
+                Point* origin = particles.get<SPARK_Origin>();
+                TimeMS* time_start = particles.get<SPARK_Start>();
+                TimeMS* delay = particles.get<SPARK_Delay>();
+                ColorValue* colors = particles.get<SPARK_Color>();
+
+                DirtyBounds drawn;
+                batch.begin(ar, get_raw_canvas(), CMODE_Transparent);
+                particles.for_each([&](size_t i){
+                    if (time_delta-time_start[i] >= delay[i]) {
                         // LOG("  EffectSparkle: Erase Spark");
                         return false;
                     } else {
                         // #desperate attempt to sanitize this..
-                        int32_t opacity = (spark.time_start > time_delta) ? 0 : 100-(100*(time_delta - spark.time_start)) / spark.delay;
+                        int32_t opacity = (time_start[i] > time_delta) ? 0 : 100-(100*(time_delta - time_start[i])) / delay[i];
 
                         opacity = (opacity > 100) ? 100 : opacity; // : (opacity > 1000) ? 0 : opacity; /// \todo evaluate
 
-                        ar->set_pixel(
-                                Point(spark.origin.x+box.origin.x,spark.origin.y+box.origin.y),
-                                spark.color,
-                                CMODE_Transparent,
+                        batch.add(
+                                Point(origin[i].x+box.origin.x,origin[i].y+box.origin.y),
+                                colors[i],
                                 (int8_t) opacity);
+                        drawn.add(origin[i].x+box.origin.x,origin[i].y+box.origin.y,1,1);
                         return true;
                     }
                 });
-                
+                batch.flush();
+                mark_dirty(drawn);
             }
 
+            virtual bool tracks_dirty() { return true; }
+
     };
 };
 #endif
\ No newline at end of file
@@ -54,6 +54,8 @@ namespace prgbfx
                     time_start = ar->get_timebase().get_deltatime_ms();
                 }
         
+            virtual const char* get_type_name() { return "EffectSpit"; }
+
             void render_effect(TimeMS time_delta) {
                 
                 if (!enabled) return;
@@ -72,6 +74,8 @@ namespace prgbfx
                  });
             }
 
+            virtual bool tracks_dirty() { return true; }
+
     };
     
 } // namespace prgbfx
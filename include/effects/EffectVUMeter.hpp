@@ -15,6 +15,7 @@
 #include <EffectColor.hpp>
 
 #include <LoudnessBase.hpp>
+#include <SoundSnapshot.hpp>
 #include <TimeBase.hpp>
 
 using namespace prgb;
@@ -28,6 +29,7 @@ class EffectVUMeter : public Effect {
     uint8_t current = 0;
     Dimension distance, offset;
     LoudnessBase& lb;
+    SoundSource sound = SoundSource(lb);
     RectArea box;
     EffectColor* color;
 
@@ -46,14 +48,21 @@ class EffectVUMeter : public Effect {
 
         virtual ~EffectVUMeter() { LOG(" EffectVUMeter: Destruct");}
 
+        virtual const char* get_type_name() { return "EffectVUMeter"; }
+
+        virtual void set_context(RenderContext* context) {
+            Effect::set_context(context);
+            sound.set_snapshot(context ? context->sound : nullptr);
+        }
+
         virtual void render_effect(TimeMS time_delta) {
             Loudness maxld = 0;
             for (int i = 0; i < 6; i++) {
                 
-                bandval[current][i] = lb.get_freq_band(i);
+                bandval[current][i] = sound.get_freq_band(i);
                 if (bandval[current][i] > maxld) maxld = bandval[current][i]; 
             }
-            maxld = (3*lb.get_loudness(LD_environment))/2;
+            maxld = (3*sound.get_loudness(LD_environment))/2;
 
             if (!enabled) return;
 
@@ -71,9 +80,12 @@ class EffectVUMeter : public Effect {
 
             }
             
+            mark_dirty(box);
             current = (current == 0) ? 1 : 0;
 
         }
 
+        virtual bool tracks_dirty() { return true; }
+
       
 };